@@ -1,7 +1,8 @@
 // maxsat_approx.cpp
 // Single-file tool for approximating weighted Max-SAT.
 //
-// Input format (stdin):
+// Input: the instance file named on the command line (default input1.txt), either in
+// DIMACS WCNF/CNF (old "p wcnf" and 2022 formats, see load_instance) or in this format:
 // n m
 // For each of m lines:
 // w k l1 l2 ... lk
@@ -9,12 +10,14 @@
 // and each li is a signed integer in range [-n,-1] or [1,n]. Positive means x_i,
 // negative means ¬x_i.
 //
-// The program prints two deterministic assignments found by derandomizing:
+// The program prints three deterministic assignments found by derandomizing:
 // 1) the 1/2-approximation obtained by derandomizing uniform random assignment,
 // 2) the (1 - 1/e)-style algorithm: solve an LP relaxation, randomized-rounding
-// probabilities, then derandomize by conditional expectation.
+// probabilities, then derandomize by conditional expectation,
+// 3) the 3/4 mixture of the two (computed together with them in one sweep).
+// It then computes the exact optimum by branch and bound (and by brute force for small n).
 //
-// Compile: g++ -O2 -std=c++17 maxsat_approx.cpp -o maxsat_approx.exe
+// Compile: g++ -O2 -std=c++17 -pthread maxsat_approx.cpp -o maxsat_approx.exe
 // Example:
 // 2 3
 // 1 2 1 2
@@ -22,11 +25,18 @@
 // 3 1 2
 
 #include <bits/stdc++.h>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 using namespace std;
 
+// lits may live in an arena (batch mode); copies fall back to the default resource
 struct Clause {
     double w;
-    vector<pair<int,int>> lits; // (var, sign) sign = +1 for positive, -1 for neg
+    pmr::vector<pair<int,int>> lits; // (var, sign) sign = +1 for positive, -1 for neg
 };
 
 // Evaluate total weight satisfied by assignment assign[1..n] (0/1)
@@ -48,56 +58,350 @@ double eval_assignment(const vector<int>& assign, const vector<Clause>& clauses)
     return total;
 }
 
-// Compute expected satisfied weight when some variables are fixed (assign[index]= -1 unassigned, 0/1 assigned)
-// and remaining variables are randomized: for derand_half use p = 0.5; for LP rounding use p = probs[var]
-double expected_weight(const vector<int>& assign, const vector<Clause>& clauses, const vector<double>& probs, double default_p) {
+// ---------------------------------------------------------------------------------------
+// Width-bucketed clause kernels. Clauses are regrouped by width once per instance: widths
+// 1..4 get flat arrays of exactly K literals each and kernels templated on K (fully unrolled,
+// no data-dependent branches, so the compiler can vectorize them); wider clauses use a CSR
+// fallback. Literals are encoded as 2*var + (negative ? 1 : 0) and looked up in per-literal
+// tables: truth[l] (1 if l is true) for evaluation, qfalse[l] (probability that l is false;
+// 0/1 for assigned variables) for expected weights (see ExpectedWeightEvaluator).
+// Clauses are numbered in bucket order, and per-variable occurrence lists over those numbers
+// serve the fused derandomization, so one ClauseBuckets per instance serves every stage.
+// ---------------------------------------------------------------------------------------
+
+struct ClauseBuckets {
+    static const int MAXK = 4;
+    struct Fixed {
+        vector<int> lits;       // K literals per clause
+        vector<double> w;
+    };
+    int n = 0;
+    int m = 0;                  // clauses kept, numbered fixed[1], ..., fixed[MAXK], then the wider ones
+    Fixed fixed[MAXK + 1];      // fixed[K] holds the width-K clauses (empty clauses are dropped)
+    int first[MAXK + 2] = {};   // number of the first clause of fixed[K]; first[MAXK+1]: wider ones
+    vector<int> gstart, glits;  // wider clauses, CSR
+    vector<double> gw;
+    vector<int> ostart, occ;    // v occurs in occ[ostart[v] .. ostart[v+1]) as (clause << 1) | neg,
+                                // clause numbers ascending
+
+    // literals of clause c at [first, second)
+    pair<const int*, const int*> lits(int c) const {
+        for (int K = 1; K <= MAXK; ++K)
+            if (c < first[K+1]) {
+                const int* b = fixed[K].lits.data() + (size_t)(c - first[K]) * K;
+                return {b, b + K};
+            }
+        int g = c - first[MAXK+1];
+        return {glits.data() + gstart[g], glits.data() + gstart[g+1]};
+    }
+
+    double weight(int c) const {
+        for (int K = 1; K <= MAXK; ++K) if (c < first[K+1]) return fixed[K].w[c - first[K]];
+        return gw[c - first[MAXK+1]];
+    }
+};
+
+ClauseBuckets bucket_clauses(int n, const vector<Clause>& clauses) {
+    ClauseBuckets B;
+    B.n = n;
+    B.gstart.push_back(0);
+    // equal weights end up adjacent within each bucket (see eval_sliced)
+    vector<int> order(clauses.size());
+    iota(order.begin(), order.end(), 0);
+    stable_sort(order.begin(), order.end(), [&](int a, int b) { return clauses[a].w < clauses[b].w; });
+    for (int ci : order) {
+        const Clause& C = clauses[ci];
+        int k = (int)C.lits.size();
+        if (k == 0) continue;
+        vector<int>& out = k <= ClauseBuckets::MAXK ? B.fixed[k].lits : B.glits;
+        for (auto& lit : C.lits) out.push_back(2 * lit.first + (lit.second == -1 ? 1 : 0));
+        if (k <= ClauseBuckets::MAXK) B.fixed[k].w.push_back(C.w);
+        else { B.gw.push_back(C.w); B.gstart.push_back((int)B.glits.size()); }
+    }
+    for (int K = 1; K <= ClauseBuckets::MAXK; ++K) B.first[K+1] = B.first[K] + (int)B.fixed[K].w.size();
+    B.m = B.first[ClauseBuckets::MAXK+1] + (int)B.gw.size();
+    B.ostart.assign(n+2, 0);
+    for (int c = 0; c < B.m; ++c)
+        for (auto r = B.lits(c); r.first != r.second; ++r.first) B.ostart[(*r.first >> 1) + 1]++;
+    for (int v = 1; v <= n + 1; ++v) B.ostart[v] += B.ostart[v-1];
+    B.occ.resize(B.ostart[n+1]);
+    vector<int> pos(B.ostart.begin(), B.ostart.end() - 1);
+    for (int c = 0; c < B.m; ++c)
+        for (auto r = B.lits(c); r.first != r.second; ++r.first) B.occ[pos[*r.first >> 1]++] = (c << 1) | (*r.first & 1);
+    return B;
+}
+
+template<int K>
+double eval_fixed(const ClauseBuckets::Fixed& F, const unsigned char* truth) {
+    const int* L = F.lits.data();
+    const double* W = F.w.data();
+    size_t m = F.w.size();
     double total = 0.0;
-    int m = clauses.size();
-    for (int i = 0; i < m; ++i) {
-        const Clause &C = clauses[i];
-        bool already_sat = false;
-        double prod_unsat = 1.0;
-        bool has_unassigned = false;
-        for (auto &lit : C.lits) {
-            int var = lit.first;
-            int sign = lit.second;
-            int a = assign[var];
-            if (a != -1) {
-                // fixed
-                if ((sign == 1 && a == 1) || (sign == -1 && a == 0)) { already_sat = true; break; }
-                else continue; // this literal cannot satisfy
-            } else {
-                has_unassigned = true;
-                double p;
-                if (!probs.empty()) p = probs[var]; else p = default_p;
-                double lit_prob_true = (sign == 1) ? p : (1.0 - p);
-                prod_unsat *= (1.0 - lit_prob_true);
+    for (size_t i = 0; i < m; ++i, L += K) {
+        unsigned s = 0;
+        for (int j = 0; j < K; ++j) s |= truth[L[j]];
+        total += W[i] * (double)s;
+    }
+    return total;
+}
+
+template<int K>
+double expected_fixed(const ClauseBuckets::Fixed& F, const double* qfalse) {
+    const int* L = F.lits.data();
+    const double* W = F.w.data();
+    size_t m = F.w.size();
+    double total = 0.0;
+    for (size_t i = 0; i < m; ++i, L += K) {
+        double q = 1.0;
+        for (int j = 0; j < K; ++j) q *= qfalse[L[j]];
+        total += W[i] * (1.0 - q);
+    }
+    return total;
+}
+
+// Satisfied weight given truth[l] for every literal
+double eval_buckets(const ClauseBuckets& B, const unsigned char* truth) {
+    double total = eval_fixed<1>(B.fixed[1], truth) + eval_fixed<2>(B.fixed[2], truth)
+                 + eval_fixed<3>(B.fixed[3], truth) + eval_fixed<4>(B.fixed[4], truth);
+    for (size_t i = 0; i < B.gw.size(); ++i) {
+        unsigned s = 0;
+        for (int e = B.gstart[i]; e < B.gstart[i+1]; ++e) s |= truth[B.glits[e]];
+        total += B.gw[i] * (double)s;
+    }
+    return total;
+}
+
+// eval_assignment on bucketed clauses (unassigned variables count as false)
+double eval_assignment(const vector<int>& assign, const ClauseBuckets& B) {
+    vector<unsigned char> truth(2 * B.n + 2, 0);
+    for (int v = 1; v <= B.n; ++v) {
+        truth[2*v] = assign[v] == 1;
+        truth[2*v+1] = assign[v] != 1;
+    }
+    return eval_buckets(B, truth.data());
+}
+
+// The 1/2, LP-rounding and mixture assignments of derand_fused
+struct FusedResult {
+    vector<int> half, lp, mix;
+};
+
+// Expected and actual satisfied weight over one ClauseBuckets, with all scratch tables owned
+// by the evaluator so repeated calls (and repeated instances, via bind) allocate nothing once
+// the buffers have grown. Per literal it caches qfalse[l] = 1 - P(l true) and its logarithm,
+// computed as log1p(-P(l true)) so probabilities near 0 keep their precision. Clauses of width
+// <= MAXK multiply qfalse directly. Wider clauses do too unless the product q is above 1/2,
+// where 1 - q would cancel; those sum the logarithms instead and take 1 - q = -expm1(sum),
+// which stays accurate when every literal is almost surely false. The fused derandomization
+// (derand_fused) reads the same logarithms and keeps its per-clause state here too, so one
+// evaluator per instance (or per worker, rebound) serves every derandomization.
+struct ExpectedWeightEvaluator {
+    const ClauseBuckets* B = nullptr;
+    vector<double> qfalse, logq;
+    vector<unsigned char> truth;
+    vector<int> assign;
+    // derand_fused: literals left under 1/2, and the LP product as a sum of logarithms of
+    // the nonzero factors plus a count of zero factors, per scheme (0 = alone, 1 = mixture)
+    vector<int> left[2], zeros[2];
+    vector<double> logp[2];
+    vector<char> sat[3];
+    FusedResult fused;
+
+    ExpectedWeightEvaluator() {}
+    explicit ExpectedWeightEvaluator(const ClauseBuckets& b) { bind(b); }
+
+    void bind(const ClauseBuckets& b) {
+        B = &b;
+        qfalse.assign(2 * b.n + 2, 1.0);
+        logq.assign(2 * b.n + 2, 0.0);
+        truth.assign(2 * b.n + 2, 0);
+        assign.assign(b.n + 1, -1);
+    }
+
+    // P(x_v = 1) = p; 0 and 1 fix the variable
+    void set_var(int v, double p) {
+        qfalse[2*v] = 1.0 - p;   logq[2*v] = log1p(-p);
+        qfalse[2*v+1] = p;       logq[2*v+1] = log(p);
+    }
+
+    // p[v] for v = 1..n, or 1/2 everywhere if p is empty
+    void set_probs(const vector<double>& p) {
+        for (int v = 1; v <= B->n; ++v) set_var(v, p.empty() ? 0.5 : p[v]);
+    }
+
+    double expected() const {
+        const double* q = qfalse.data();
+        double total = expected_fixed<1>(B->fixed[1], q) + expected_fixed<2>(B->fixed[2], q)
+                     + expected_fixed<3>(B->fixed[3], q) + expected_fixed<4>(B->fixed[4], q);
+        for (size_t i = 0; i < B->gw.size(); ++i) {
+            double prod = 1.0, lq = 0.0;
+            for (int e = B->gstart[i]; e < B->gstart[i+1]; ++e) {
+                prod *= q[B->glits[e]];
+                lq += logq[B->glits[e]];
             }
+            total += B->gw[i] * (prod < 0.5 ? 1.0 - prod : -expm1(lq));
         }
-        double prob_sat = 0.0;
-        if (already_sat) prob_sat = 1.0;
-        else {
-            if (!has_unassigned) prob_sat = 0.0;
-            else prob_sat = 1.0 - prod_unsat;
+        return total;
+    }
+
+    // satisfied weight of a[1..n] (unassigned variables count as false)
+    double value(const vector<int>& a) {
+        for (int v = 1; v <= B->n; ++v) {
+            truth[2*v] = a[v] == 1;
+            truth[2*v+1] = a[v] != 1;
         }
-        total += C.w * prob_sat;
+        return eval_buckets(*B, truth.data());
+    }
+
+    // Method of conditional expectations; variable v is 1 with probability p[v] (1/2 if p is
+    // empty) while unassigned. The result lives in this evaluator until the next call.
+    const vector<int>& derandomize(const vector<double>& p) {
+        set_probs(p);
+        for (int v = 1; v <= B->n; ++v) {
+            set_var(v, 1.0);
+            double e1 = expected();
+            set_var(v, 0.0);
+            double e0 = expected();
+            if (e1 > e0) { assign[v] = 1; set_var(v, 1.0); }
+            else assign[v] = 0;
+        }
+        return assign;
+    }
+};
+
+// ---------------------------------------------------------------------------------------
+// Bit-sliced evaluation of 64*W assignments per clause sweep. Bit j of word k in variable
+// v's slice is v's value in assignment 64*k + j, so a clause's satisfied assignments are the
+// OR of its literals' slices (complemented for negative literals), and every assignment's
+// satisfied weight is the total weight minus the weights of the lanes left unsatisfied.
+// Unsatisfied lanes are tallied in bit-sliced counters (one word per bit of the count, carry
+// rippled with AND/XOR) over runs of equal weight, which bucket_clauses makes contiguous, so
+// per-lane arithmetic only happens once per distinct weight.
+// W = 4 (256 lanes) when AVX2 is available so the word loops map onto 256-bit registers.
+// ---------------------------------------------------------------------------------------
+
+#ifdef __AVX2__
+const int BITSLICE_WORDS = 4;
+#else
+const int BITSLICE_WORDS = 1;
+#endif
+const int BITSLICE_LANES = 64 * BITSLICE_WORDS;
+
+template<int W>
+struct Slice {
+    uint64_t w[W];
+};
+
+// Per-lane count of unsatisfied clauses of the current weight, flushed into out[] when the
+// weight changes
+template<int W>
+struct LaneCounter {
+    vector<Slice<W>> planes;
+    double weight = 0.0;
+    double* out;
+
+    explicit LaneCounter(double* o) : out(o) {}
+
+    void add_unsat(const Slice<W>& sat, double wt) {
+        if (wt != weight) { flush(); weight = wt; }
+        Slice<W> carry;
+        for (int k = 0; k < W; ++k) carry.w[k] = ~sat.w[k];
+        for (size_t p = 0;; ++p) {
+            if (p == planes.size()) planes.push_back(Slice<W>{});
+            uint64_t any = 0;
+            for (int k = 0; k < W; ++k) {
+                uint64_t t = planes[p].w[k] & carry.w[k];
+                planes[p].w[k] ^= carry.w[k];
+                carry.w[k] = t;
+                any |= t;
+            }
+            if (!any) break;
+        }
+    }
+
+    void flush() {
+        for (size_t p = 0; p < planes.size(); ++p) {
+            double x = ldexp(weight, (int)p);
+            for (int k = 0; k < W; ++k)
+                for (uint64_t u = planes[p].w[k]; u; u &= u - 1) out[64*k + __builtin_ctzll(u)] += x;
+        }
+        planes.clear();
+    }
+};
+
+template<int W, int K>
+void unsat_fixed(const ClauseBuckets::Fixed& F, const Slice<W>* lit, LaneCounter<W>& C) {
+    const int* L = F.lits.data();
+    size_t m = F.w.size();
+    for (size_t i = 0; i < m; ++i, L += K) {
+        Slice<W> s = lit[L[0]];
+        for (int j = 1; j < K; ++j)
+            for (int k = 0; k < W; ++k) s.w[k] |= lit[L[j]].w[k];
+        C.add_unsat(s, F.w[i]);
     }
-    return total;
 }
 
-// Derandomized 1/2 algorithm: variables set greedily by conditional expectation where unassigned vars are uniform p=1/2
-vector<int> derand_half(int n, const vector<Clause>& clauses) {
-    vector<int> assign(n+1, -1);
-    for (int v = 1; v <= n; ++v) {
-        assign[v] = 1;
-        double e1 = expected_weight(assign, clauses, {}, 0.5);
-        assign[v] = 0;
-        double e0 = expected_weight(assign, clauses, {}, 0.5);
-        if (e1 > e0) assign[v] = 1; else assign[v] = 0;
+// out[lane] = satisfied weight of each of the 64*W lanes; var[v] holds v's slice (v = 1..n)
+template<int W>
+void eval_sliced(const ClauseBuckets& B, const Slice<W>* var, double* out) {
+    vector<Slice<W>> lit(2 * B.n + 2);
+    for (int v = 1; v <= B.n; ++v)
+        for (int k = 0; k < W; ++k) { lit[2*v].w[k] = var[v].w[k]; lit[2*v+1].w[k] = ~var[v].w[k]; }
+    double total = 0.0;
+    for (int K = 1; K <= ClauseBuckets::MAXK; ++K) for (double w : B.fixed[K].w) total += w;
+    for (double w : B.gw) total += w;
+    vector<double> unsat(64 * W, 0.0);
+    LaneCounter<W> C(unsat.data());
+    unsat_fixed<W, 1>(B.fixed[1], lit.data(), C);
+    unsat_fixed<W, 2>(B.fixed[2], lit.data(), C);
+    unsat_fixed<W, 3>(B.fixed[3], lit.data(), C);
+    unsat_fixed<W, 4>(B.fixed[4], lit.data(), C);
+    for (size_t i = 0; i < B.gw.size(); ++i) {
+        Slice<W> s{};
+        for (int e = B.gstart[i]; e < B.gstart[i+1]; ++e)
+            for (int k = 0; k < W; ++k) s.w[k] |= lit[B.glits[e]].w[k];
+        C.add_unsat(s, B.gw[i]);
+    }
+    C.flush();
+    for (int j = 0; j < 64 * W; ++j) out[j] = total - unsat[j];
+}
+
+// Satisfied weight of every assignment in assigns (unassigned variables count as false),
+// BITSLICE_LANES assignments per sweep
+vector<double> eval_assignments(const ClauseBuckets& B, const vector<vector<int>>& assigns) {
+    const int W = BITSLICE_WORDS;
+    vector<double> res(assigns.size());
+    vector<Slice<W>> var(B.n + 1);
+    double out[BITSLICE_LANES];
+    for (size_t base = 0; base < assigns.size(); base += BITSLICE_LANES) {
+        size_t cnt = min<size_t>(BITSLICE_LANES, assigns.size() - base);
+        fill(var.begin(), var.end(), Slice<W>{});
+        for (size_t j = 0; j < cnt; ++j) {
+            const int* a = assigns[base + j].data();
+            for (int v = 1; v <= B.n; ++v) var[v].w[j >> 6] |= (uint64_t)(a[v] == 1) << (j & 63);
+        }
+        eval_sliced<W>(B, var.data(), out);
+        for (size_t j = 0; j < cnt; ++j) res[base + j] = out[j];
     }
-    return assign;
+    return res;
 }
 
+// Derandomized 1/2 algorithm: variables set greedily by conditional expectation where unassigned vars are uniform p=1/2
+vector<int> derand_half(ExpectedWeightEvaluator& E) {
+    return E.derandomize({});
+}
+
+// Cooperative cancellation for the long-running stages (LP, local search, branch and bound):
+// a wall-clock deadline and/or an external flag, e.g. set by a SIGINT handler. Stages poll
+// stop() every few hundred iterations and return their best result so far.
+struct StopCondition {
+    chrono::steady_clock::time_point deadline = chrono::steady_clock::time_point::max();
+    const atomic<bool>* flag = nullptr;
+    bool stop() const {
+        return (flag && flag->load(memory_order_relaxed)) || chrono::steady_clock::now() >= deadline;
+    }
+};
+
 // Simplex solver for LP in standard form: maximize c^T x subject to A x <= b, x >= 0
 const double EPS = 1e-9;
 
@@ -105,9 +409,15 @@ struct Simplex {
     int m, n; // m constraints, n variables
     vector<vector<double>> a; // tableau (m+1) x (n+1), last column is RHS
     vector<int> B, N;
+    // incremental interface bookkeeping: variable ids of the structural variables and of the
+    // slacks (one per constraint), and the current objective / right-hand sides
+    vector<int> structId, slackId;
+    vector<double> cost, rhs;
+    int nextId;
+    int colCapacity = 0;      // entries reserved in every row, see reserve_columns
     Simplex(const vector<vector<double>>& A, const vector<double>& b, const vector<double>& c) {
         m = (int)A.size();
-        n = (int)A[0].size();
+        n = (int)c.size();
         a.assign(m+1, vector<double>(n+1));
         for (int i = 0; i < m; ++i) {
             for (int j = 0; j < n; ++j) a[i+1][j+1] = A[i][j];
@@ -119,6 +429,11 @@ struct Simplex {
         N.assign(n+1, 0);
         for (int i = 1; i <= m; ++i) B[i] = n + i;
         for (int j = 1; j <= n; ++j) N[j] = j;
+        for (int j = 1; j <= n; ++j) structId.push_back(j);
+        for (int i = 1; i <= m; ++i) slackId.push_back(n + i);
+        cost = c;
+        rhs = b;
+        nextId = n + m + 1;
     }
 
     void pivot(int r, int s) {
@@ -133,18 +448,36 @@ struct Simplex {
         swap(B[r], N[s]);
     }
 
-    // returns pair (maxValue, solution vector x of size n)
-    pair<double, vector<double>> solve() {
+    // where variable id sits: row i > 0 if basic, otherwise -column
+    int locate(int id) const {
+        for (int i = 1; i <= m; ++i) if (B[i] == id) return i;
+        for (int j = 1; j <= n; ++j) if (N[j] == id) return -j;
+        return 0;
+    }
+
+    vector<double> solution() const {
+        vector<double> val(nextId, 0.0);
+        for (int i = 1; i <= m; ++i) val[B[i]] = a[i][0];
+        vector<double> sol(structId.size());
+        for (size_t j = 0; j < structId.size(); ++j) sol[j] = val[structId[j]];
+        return sol;
+    }
+
+    // returns pair (maxValue, solution vector x of size n); maxValue is NaN if halt fired
+    // Bland's rule (smallest variable index enters and, among tied ratios, leaves) keeps the
+    // very degenerate Max-SAT relaxations from cycling
+    pair<double, vector<double>> solve(const StopCondition* halt = nullptr) {
         while (true) {
+            if (halt && halt->stop()) return {numeric_limits<double>::quiet_NaN(), vector<double>()};
             int s = 0;
-            for (int j = 1; j <= n; ++j) if (a[0][j] < -EPS) { s = j; break; }
+            for (int j = 1; j <= n; ++j) if (a[0][j] < -EPS && (s == 0 || N[j] < N[s])) s = j;
             if (s == 0) break;
             int r = 0;
             double minRatio = 1e300;
             for (int i = 1; i <= m; ++i) {
                 if (a[i][s] > EPS) {
                     double ratio = a[i][0] / a[i][s];
-                    if (ratio < minRatio - EPS) { minRatio = ratio; r = i; }
+                    if (ratio < minRatio - EPS || (ratio < minRatio + EPS && B[i] < B[r])) { minRatio = ratio; r = i; }
                 }
             }
             if (r == 0) {
@@ -153,17 +486,107 @@ struct Simplex {
             }
             pivot(r, s);
         }
+        return {a[0][0], solution()};
+    }
 
-        vector<double> x(n+1, 0.0);
-        for (int i = 1; i <= m; ++i) if (B[i] <= n) x[B[i]] = a[i][0];
-        vector<double> sol(n);
-        for (int j = 1; j <= n; ++j) sol[j-1] = x[j];
-        return {a[0][0], sol};
+    // ---- incremental interface: every change keeps the current basis ----
+
+    // Room for extra more columns in every row (and in rows added later), so add_column
+    // appends in place instead of reallocating the whole tableau
+    void reserve_columns(int extra) {
+        colCapacity = max(colCapacity, n + 1 + extra);
+        for (auto& row : a) row.reserve(colCapacity);
+    }
+
+    // New structural variable with objective coefficient c and entries col = (constraint k, A[k]).
+    // It enters nonbasic at 0, so the basis stays primal feasible. Returns its index.
+    int add_column(const vector<pair<int,double>>& col, double c) {
+        if (n + 2 > colCapacity) reserve_columns(max(n, 16));   // capacity doubles
+        for (auto& row : a) row.push_back(0.0);
+        ++n;
+        N.push_back(nextId);
+        structId.push_back(nextId++);
+        cost.push_back(c);
+        a[0][n] = -c;
+        // the column is B^-1 A_col: each slack s_k stands for b_k - A_k x, so substitute
+        // s_k -> s_k + A[k] * t in the dictionary
+        for (auto& e : col) {
+            int p = locate(slackId[e.first]);
+            if (p > 0) a[p][n] += e.second;
+            else for (int i = 0; i <= m; ++i) a[i][n] += e.second * a[i][-p];
+        }
+        return (int)structId.size() - 1;
+    }
+
+    // New constraint sum coeffs (structural j, A[j]) <= b, written in terms of the current
+    // nonbasic variables; its slack becomes basic. Returns its index. The RHS may come out
+    // negative (the current point violates the row); dual_solve() repairs that.
+    int add_row(const vector<pair<int,double>>& coeffs, double b) {
+        vector<double> row;
+        row.reserve(max(colCapacity, n + 1));
+        row.assign(n+1, 0.0);
+        row[0] = b;
+        for (auto& e : coeffs) {
+            int p = locate(structId[e.first]);
+            if (p < 0) row[-p] += e.second;
+            else if (p > 0) for (int j = 0; j <= n; ++j) row[j] -= e.second * a[p][j];
+        }
+        a.push_back(move(row));
+        ++m;
+        B.push_back(nextId);
+        slackId.push_back(nextId++);
+        rhs.push_back(b);
+        return (int)slackId.size() - 1;
+    }
+
+    // Change the objective coefficient of structural j; the basis stays primal feasible.
+    void set_objective(int j, double c) {
+        double d = c - cost[j];
+        cost[j] = c;
+        int p = locate(structId[j]);
+        if (p < 0) a[0][-p] -= d;
+        else for (int k = 0; k <= n; ++k) a[0][k] += d * a[p][k];
+    }
+
+    // Change the right-hand side of constraint k; the basis stays dual feasible.
+    void set_rhs(int k, double b) {
+        double d = b - rhs[k];
+        rhs[k] = b;
+        int p = locate(slackId[k]);
+        if (p > 0) a[p][0] += d;
+        else for (int i = 0; i <= m; ++i) a[i][0] += d * a[i][-p];
+    }
+
+    // Dual simplex from a dual feasible basis until the RHS is nonnegative (Bland's rule
+    // again), then primal simplex for anything the changes left dual infeasible.
+    // maxValue is -infinity if the constraints became infeasible, NaN if halt fired.
+    pair<double, vector<double>> dual_solve(const StopCondition* halt = nullptr) {
+        while (true) {
+            if (halt && halt->stop()) return {numeric_limits<double>::quiet_NaN(), vector<double>()};
+            int r = 0;
+            for (int i = 1; i <= m; ++i) if (a[i][0] < -EPS && (r == 0 || B[i] < B[r])) r = i;
+            if (r == 0) break;
+            int s = 0;
+            double minRatio = 1e300;
+            for (int j = 1; j <= n; ++j) {
+                if (a[r][j] < -EPS) {
+                    double ratio = max(a[0][j], 0.0) / -a[r][j];
+                    if (ratio < minRatio - EPS || (ratio < minRatio + EPS && N[j] < N[s])) { minRatio = ratio; s = j; }
+                }
+            }
+            if (s == 0) return {-numeric_limits<double>::infinity(), vector<double>()};
+            pivot(r, s);
+        }
+        for (int i = 1; i <= m; ++i) a[i][0] = max(a[i][0], 0.0);   // round-off below -EPS
+        return solve(halt);
     }
 };
 
-// Build and solve LP relaxation, return vector<double> x_probs for variables 1..n
-vector<double> solve_lp_relaxation(int n, const vector<Clause>& clauses) {
+// The Max-SAT LP relaxation in the layout Simplex expects.
+// Variables: x_1..x_n, y_1..y_m (columns 0..n-1, n..n+m-1).
+// Constraints: rows 0..m-1 clauses, m..m+n-1 x_i <= 1, m+n..2m+n-1 y_C <= 1.
+void build_lp_relaxation(int n, const vector<Clause>& clauses, vector<vector<double>>& A,
+                         vector<double>& b, vector<double>& c) {
     int m = clauses.size();
     // Variables: x_1..x_n, y_1..y_m  => total n + m
     int Nvars = n + m;
@@ -172,8 +595,8 @@ vector<double> solve_lp_relaxation(int n, const vector<Clause>& clauses) {
     // For each x_i: x_i <= 1
     // For each y_C: y_C <= 1
     int mcons = m + n + m;
-    vector<vector<double>> A(mcons, vector<double>(Nvars, 0.0));
-    vector<double> b(mcons, 0.0);
+    A.assign(mcons, vector<double>(Nvars, 0.0));
+    b.assign(mcons, 0.0);
     int row = 0;
     for (int ci = 0; ci < m; ++ci) {
         const Clause &C = clauses[ci];
@@ -209,17 +632,12 @@ vector<double> solve_lp_relaxation(int n, const vector<Clause>& clauses) {
     }
 
     // objective: maximize sum w_C * y_C => c vector of length Nvars
-    vector<double> c(Nvars, 0.0);
+    c.assign(Nvars, 0.0);
     for (int ci = 0; ci < m; ++ci) c[n + ci] = clauses[ci].w;
+}
 
-    Simplex solver(A, b, c);
-    auto res = solver.solve();
-    if (!isfinite(res.first)) {
-        // fallback: uniform 1/2
-        vector<double> fallback(n+1, 0.5);
-        return fallback;
-    }
-    vector<double> sol = res.second; // size Nvars
+// LP solution (structural values) to x_probs[1..n], clamped to [0, 1]
+vector<double> lp_probs(int n, const vector<double>& sol) {
     vector<double> x_probs(n+1, 0.0);
     for (int i = 0; i < n; ++i) {
         double v = sol[i];
@@ -230,126 +648,2133 @@ vector<double> solve_lp_relaxation(int n, const vector<Clause>& clauses) {
     return x_probs;
 }
 
+// Build and solve LP relaxation, return vector<double> x_probs for variables 1..n.
+// If lp_value is given it receives the LP optimum (an upper bound on the Max-SAT optimum),
+// or +infinity when the solver failed or was stopped by halt and the uniform fallback was returned.
+vector<double> solve_lp_relaxation(int n, const vector<Clause>& clauses, double* lp_value = nullptr,
+                                   const StopCondition* halt = nullptr) {
+    if (n == 0 && clauses.empty()) {
+        if (lp_value) *lp_value = 0.0;
+        return vector<double>(n+1, 0.0);
+    }
+    vector<vector<double>> A;
+    vector<double> b, c;
+    build_lp_relaxation(n, clauses, A, b, c);
+
+    Simplex solver(A, b, c);
+    auto res = solver.solve(halt);
+    if (lp_value) *lp_value = isnan(res.first) ? numeric_limits<double>::infinity() : res.first;
+    if (!isfinite(res.first)) {
+        // fallback: uniform 1/2
+        vector<double> fallback(n+1, 0.5);
+        return fallback;
+    }
+    return lp_probs(n, res.second);
+}
+
+// The LP relaxation kept alive between solves: clauses can be added, re-weighted and
+// variables fixed, and each solve() starts from the previous optimal basis. Adding a clause
+// (with y_C = 0 the new rows hold at the current point) and changing a weight keep the basis
+// primal feasible and need only primal pivots; fixing a variable changes a right-hand side,
+// keeps it dual feasible and is repaired by dual simplex.
+struct IncrementalMaxSatLP {
+    int n;
+    Simplex lp;
+    vector<int> yCol;        // clause -> structural index of y_C
+    vector<int> upperRow;    // variable -> constraint x_v <= 1
+    vector<int> lowerRow;    // variable -> constraint -x_v <= 0 (-1 until first needed)
+    double value = 0.0;
+
+    static Simplex build(int n, const vector<Clause>& clauses) {
+        vector<vector<double>> A;
+        vector<double> b, c;
+        build_lp_relaxation(n, clauses, A, b, c);
+        return Simplex(A, b, c);
+    }
+
+    IncrementalMaxSatLP(int vars, const vector<Clause>& clauses) : n(vars), lp(build(vars, clauses)) {
+        int m = clauses.size();
+        for (int ci = 0; ci < m; ++ci) yCol.push_back(n + ci);
+        for (int v = 1; v <= n; ++v) upperRow.push_back(m + v - 1);
+        upperRow.insert(upperRow.begin(), -1);
+        lowerRow.assign(n+1, -1);
+    }
+
+    // Room for `clauses` more clauses without reallocating the tableau
+    void reserve(int clauses) {
+        lp.reserve_columns(clauses);
+        lp.a.reserve(lp.a.size() + 2 * clauses);
+    }
+
+    // Returns the clause index. Literals must use variables 1..n.
+    int add_clause(const Clause& C) {
+        int y = lp.add_column({}, C.w);
+        vector<pair<int,double>> row;
+        int negcnt = 0;
+        for (auto& lit : C.lits) {
+            row.push_back({lit.first - 1, lit.second == 1 ? -1.0 : 1.0});
+            if (lit.second == -1) negcnt++;
+        }
+        row.push_back({y, 1.0});
+        lp.add_row(row, negcnt);
+        lp.add_row({{y, 1.0}}, 1.0);
+        yCol.push_back(y);
+        return (int)yCol.size() - 1;
+    }
+
+    void set_weight(int ci, double w) { lp.set_objective(yCol[ci], w); }
+
+    // val = 0 or 1 fixes x_v, -1 releases it
+    void fix_variable(int v, int val) {
+        if (val == 1 && lowerRow[v] < 0) lowerRow[v] = lp.add_row({{v - 1, -1.0}}, 0.0);
+        lp.set_rhs(upperRow[v], val == 0 ? 0.0 : 1.0);
+        if (lowerRow[v] >= 0) lp.set_rhs(lowerRow[v], val == 1 ? -1.0 : 0.0);
+    }
+
+    // Re-optimize from the current basis; returns the LP optimum (+infinity if halted,
+    // -infinity if the fixings are infeasible).
+    double solve(const StopCondition* halt = nullptr) {
+        auto res = lp.dual_solve(halt);
+        value = isnan(res.first) ? numeric_limits<double>::infinity() : res.first;
+        return value;
+    }
+
+    vector<double> probs() const { return lp_probs(n, lp.solution()); }
+};
+
 // Derandomize randomized rounding with probabilities x_probs using conditional expectation
-vector<int> derand_lp_rounding(int n, const vector<Clause>& clauses, const vector<double>& x_probs) {
-    vector<int> assign(n+1, -1);
-    for (int v = 1; v <= n; ++v) {
-        assign[v] = 1;
-        double e1 = expected_weight(assign, clauses, x_probs, 0.0);
-        assign[v] = 0;
-        double e0 = expected_weight(assign, clauses, x_probs, 0.0);
-        if (e1 > e0) assign[v] = 1; else assign[v] = 0;
+vector<int> derand_lp_rounding(ExpectedWeightEvaluator& E, const vector<double>& x_probs) {
+    return E.derandomize(x_probs);
+}
+
+// Occurrence lists in CSR form: for variable v, entries occ[start[v] .. start[v+1]) hold
+// (clause index << 1) | neg, one entry per literal occurrence.
+struct OccurrenceLists {
+    vector<int> start;
+    vector<int> occ;
+};
+
+OccurrenceLists build_occurrences(int n, const vector<Clause>& clauses) {
+    OccurrenceLists O;
+    O.start.assign(n+2, 0);
+    for (auto &C : clauses) for (auto &lit : C.lits) O.start[lit.first + 1]++;
+    for (int v = 1; v <= n + 1; ++v) O.start[v] += O.start[v-1];
+    O.occ.resize(O.start[n+1]);
+    vector<int> pos(O.start.begin(), O.start.end() - 1);
+    int m = clauses.size();
+    for (int ci = 0; ci < m; ++ci)
+        for (auto &lit : clauses[ci].lits)
+            O.occ[pos[lit.first]++] = (ci << 1) | (lit.second == -1 ? 1 : 0);
+    return O;
+}
+
+// ---------------------------------------------------------------------------------------
+// Fused derandomization: the 1/2 assignment, the LP-rounding assignment and the
+// Goemans-Williamson 3/4 mixture (a fair coin picks one of the two roundings) in a single
+// sweep over the occurrence lists of the instance's ClauseBuckets. Per clause and rounding
+// scheme we keep whether it is satisfied and the probability that its unassigned literals are
+// all false: under p = 1/2 as the number of literals left (q = 2^-left, exact), under the LP
+// probabilities as a sum of logarithms of the nonzero factors (the evaluator's cached
+// log1p(-p) / log p) plus a count of zero factors (LP values of exactly 0/1 are common).
+// Removing a factor subtracts its logarithm, so the product neither drifts like repeated
+// division nor underflows while factors are taken out.
+// Fixing v only touches v's clauses: taking v's factors out of a clause's product gives
+// the probability q that the rest stays false, so the clause adds +-w*q to
+// E[W | v=1] - E[W | v=0]. The mixture's gain is the mean of the two schemes' gains taken
+// on the mixture's own assignment, so its expected weight, hence its value, is >= 3/4 OPT.
+// Decisions equal those of derand_half / derand_lp_rounding up to rounding of exact ties.
+// ---------------------------------------------------------------------------------------
+
+struct FusedDerand {
+    // schemes: 0 = 1/2, 1 = LP rounding, 2 = mixture (tracked under both probability sets)
+    enum { HALF, LP, MIX };
+
+    ExpectedWeightEvaluator& E;
+    const ClauseBuckets& B;
+    vector<int>* assign[3];
+
+    FusedDerand(ExpectedWeightEvaluator& e, const vector<double>& x_probs)
+        : E(e), B(*e.B), assign{&e.fused.half, &e.fused.lp, &e.fused.mix} {
+        E.set_probs(x_probs);     // logq[l] = log P(l false) under LP rounding
+        for (int k = 0; k < 2; ++k) {
+            E.left[k].assign(B.m, 0);
+            E.zeros[k].assign(B.m, 0);
+            E.logp[k].assign(B.m, 0.0);
+        }
+        for (auto& s : E.sat) s.assign(B.m, 0);
+        for (auto* a : assign) a->assign(B.n + 1, -1);
+        for (int c = 0; c < B.m; ++c) {
+            auto r = B.lits(c);
+            E.left[0][c] = E.left[1][c] = (int)(r.second - r.first);
+            for (; r.first != r.second; ++r.first) { mul(0, c, *r.first); mul(1, c, *r.first); }
+        }
+    }
+
+    // LP product k of clause c times / divided by P(literal l false)
+    void mul(int k, int c, int l) { if (isinf(E.logq[l])) E.zeros[k][c]++; else E.logp[k][c] += E.logq[l]; }
+    void div(int k, int c, int l) { if (isinf(E.logq[l])) E.zeros[k][c]--; else E.logp[k][c] -= E.logq[l]; }
+
+    // Clause c has v's literals at occ[b, e) and q is the probability that its other
+    // unassigned literals are all false: the gain w*q of setting v to 1 over 0
+    double gain(size_t b, size_t e, double q) const {
+        bool hasPos = false, hasNeg = false;
+        for (size_t k = b; k < e; ++k) (B.occ[k] & 1 ? hasNeg : hasPos) = true;
+        int c = B.occ[b] >> 1;
+        // E1 - E0 = w * ((hasPos ? 1 : 1-q) - (hasNeg ? 1 : 1-q))
+        return B.weight(c) * ((hasPos ? q : 0.0) - (hasNeg ? q : 0.0));
+    }
+
+    // take v's literals at occ[b, e) out of clause c's state k under 1/2 / under LP rounding
+    // (the state for "v set and not satisfying c") and return the gain
+    double take_out_half(int k, int c, size_t b, size_t e) {
+        E.left[k][c] -= (int)(e - b);
+        return gain(b, e, ldexp(1.0, -E.left[k][c]));
+    }
+    double take_out_lp(int k, int c, int v, size_t b, size_t e) {
+        for (size_t j = b; j < e; ++j) div(k, c, 2 * v + (B.occ[j] & 1));
+        return gain(b, e, E.zeros[k][c] ? 0.0 : exp(E.logp[k][c]));
+    }
+
+    void run() {
+        for (int v = 1; v <= B.n; ++v) {
+            size_t s = B.ostart[v], e = B.ostart[v+1];
+            double g[3] = {0.0, 0.0, 0.0};
+            // pass 1: gains; v's factors leave the products for good (if the decision does
+            // not satisfy the clause, v's literals are false and contribute a factor 1)
+            for (size_t b = s; b < e; ) {
+                int c = B.occ[b] >> 1;
+                size_t f = b;
+                while (f < e && (B.occ[f] >> 1) == c) ++f;
+                if (!E.sat[HALF][c]) g[HALF] += take_out_half(0, c, b, f);
+                if (!E.sat[LP][c]) g[LP] += take_out_lp(0, c, v, b, f);
+                if (!E.sat[MIX][c]) g[MIX] += 0.5 * (take_out_half(1, c, b, f) + take_out_lp(1, c, v, b, f));
+                b = f;
+            }
+            for (int k = 0; k < 3; ++k) (*assign[k])[v] = g[k] > 0.0 ? 1 : 0;
+            // pass 2: mark the clauses each decision satisfies
+            for (size_t b = s; b < e; ++b) {
+                int c = B.occ[b] >> 1;
+                bool neg = B.occ[b] & 1;
+                for (int k = 0; k < 3; ++k) if (((*assign[k])[v] == 1) != neg) E.sat[k][c] = 1;
+            }
+        }
+    }
+};
+
+// The three assignments for probabilities x_probs (1/2 everywhere if empty) on E's clauses;
+// the result lives in E until the next call.
+const FusedResult& derand_fused(ExpectedWeightEvaluator& E, const vector<double>& x_probs) {
+    FusedDerand F(E, x_probs);
+    F.run();
+    return E.fused;
+}
+
+// ---------------------------------------------------------------------------------------
+// Randomized rounding portfolio: many independent roundings scored BITSLICE_LANES at a time.
+// Sample s uses p = 1/2 for even s and the LP probabilities for odd s. Bit v of sample s is
+// drawn from a counter-based generator (splitmix64 of seed, s and v), so any sample can be
+// regenerated from its index, results do not depend on the thread count, and the winning
+// assignment is rebuilt at the end instead of being stored.
+// ---------------------------------------------------------------------------------------
+
+inline uint64_t splitmix64(uint64_t x) {
+    x += 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+struct PortfolioResult {
+    double value = -1.0;     // satisfied weight of the best sample (on the clauses given)
+    long long sample = -1;   // its index; odd indices are LP roundings
+    long long drawn = 0;     // samples actually scored (fewer if halted)
+    vector<int> assign;
+};
+
+// probability of x_v = 1 as a 64-bit threshold; p >= 1 is always true
+struct RoundingSource {
+    vector<uint64_t> below;
+    vector<char> always;
+    RoundingSource(int n, const vector<double>& p) : below(n+1, 0), always(n+1, 0) {
+        for (int v = 1; v <= n; ++v) {
+            double q = p.empty() ? 0.5 : p[v];
+            if (q >= 1.0) always[v] = 1;
+            else if (q > 0.0) below[v] = (uint64_t)ldexp(q, 64);
+        }
+    }
+    bool bit(uint64_t key, int v) const { return always[v] || splitmix64(key + (uint64_t)v) < below[v]; }
+};
+
+inline uint64_t portfolio_key(uint64_t seed, long long s) { return splitmix64(seed ^ ((uint64_t)s * 0xd1b54a32d192ed03ULL)); }
+
+// Draws `samples` roundings (half from p = 1/2, half from x_probs; all from 1/2 if x_probs
+// is empty) on `threads` threads (0 = all cores) and returns the best one. halt is checked
+// between blocks of BITSLICE_LANES samples.
+PortfolioResult rounding_portfolio(const ClauseBuckets& B, const vector<double>& x_probs, long long samples,
+                                   uint64_t seed, int threads = 0, const StopCondition* halt = nullptr) {
+    const int W = BITSLICE_WORDS;
+    int n = B.n;
+    RoundingSource src[2] = {RoundingSource(n, {}), RoundingSource(n, x_probs)};
+    if (threads <= 0) threads = max(1u, thread::hardware_concurrency());
+    long long blocks = (samples + BITSLICE_LANES - 1) / BITSLICE_LANES;
+    threads = (int)max(1LL, min<long long>(threads, blocks));
+    atomic<long long> next{0}, drawn{0};
+    vector<PortfolioResult> best(threads);
+    auto worker = [&](int t) {
+        vector<Slice<W>> var(n + 1);
+        double out[BITSLICE_LANES];
+        PortfolioResult& mine = best[t];
+        long long b;
+        while ((b = next.fetch_add(1)) < blocks) {
+            if (halt && halt->stop()) break;
+            long long base = b * BITSLICE_LANES;
+            int cnt = (int)min<long long>(BITSLICE_LANES, samples - base);
+            fill(var.begin(), var.end(), Slice<W>{});
+            for (int j = 0; j < cnt; ++j) {
+                long long s = base + j;
+                const RoundingSource& R = src[s & 1];
+                uint64_t key = portfolio_key(seed, s);
+                uint64_t bitj = 1ULL << (j & 63);
+                for (int v = 1; v <= n; ++v) if (R.bit(key, v)) var[v].w[j >> 6] |= bitj;
+            }
+            eval_sliced<W>(B, var.data(), out);
+            for (int j = 0; j < cnt; ++j)
+                if (out[j] > mine.value) { mine.value = out[j]; mine.sample = base + j; }
+            drawn += cnt;
+        }
+    };
+    vector<thread> pool;
+    for (int t = 1; t < threads; ++t) pool.emplace_back(worker, t);
+    worker(0);
+    for (auto& th : pool) th.join();
+    PortfolioResult res;
+    for (auto& r : best)
+        if (r.value > res.value || (r.value == res.value && r.sample >= 0 && r.sample < res.sample)) res = r;
+    res.drawn = drawn.load();
+    if (res.sample >= 0) {
+        res.assign.assign(n+1, 0);
+        uint64_t key = portfolio_key(seed, res.sample);
+        for (int v = 1; v <= n; ++v) res.assign[v] = src[res.sample & 1].bit(key, v) ? 1 : 0;
     }
-    return assign;
+    return res;
 }
 
-// Brute-force exact solver: checks all 2^n assignments and returns best value and assignment.
-pair<double, vector<int>> brute_force_opt(int n, const vector<Clause>& clauses) {
+// Exact solver over all 2^n assignments walked in Gray-code order: step i flips the single
+// variable ctz(i)+1, so only that variable's clauses are touched. Each clause keeps a counter
+// of its true literals and the satisfied weight is updated when a counter crosses zero.
+// The index range [0, 2^n) is split into contiguous chunks, one per thread.
+pair<double, vector<int>> brute_force_gray(int n, const vector<Clause>& clauses, int threads = 0) {
     if (n >= 64) {
         cerr << "Brute-force enumeration for n >= 64 is not supported (would overflow 64-bit loop).\n";
         return { -1.0, vector<int>() };
     }
-    uint64_t total = (n == 64) ? 0ULL : (1ULL << n);
-    double bestVal = -1.0;
+    const uint64_t total = 1ULL << n;
+    if (threads <= 0) threads = max(1u, thread::hardware_concurrency());
+    threads = (int)min<uint64_t>((uint64_t)threads, total);
+
+    const OccurrenceLists O = build_occurrences(n, clauses);
+    const int m = clauses.size();
+    vector<double> w(m);
+    for (int ci = 0; ci < m; ++ci) w[ci] = clauses[ci].w;
+
+    // The running value drifts with repeated += / -= of doubles; recompute it from the
+    // counters once per block so the error stays bounded on long enumerations.
+    const uint64_t RESYNC_STEP = 1ULL << 20;
+    atomic<uint64_t> done(0);
+
+    vector<double> bestVal(threads, -1.0);
+    vector<uint64_t> bestCode(threads, 0);
+
+    auto worker = [&](int t) {
+        uint64_t lo = total / threads * t + min<uint64_t>(t, total % threads);
+        uint64_t hi = lo + total / threads + (t < (int)(total % threads) ? 1 : 0);
+        uint64_t code = lo ^ (lo >> 1);
+        vector<int> cnt(m, 0);
+        for (int ci = 0; ci < m; ++ci)
+            for (auto &lit : clauses[ci].lits) {
+                int val = (code >> (lit.first - 1)) & 1ULL;
+                if ((lit.second == 1) == (val == 1)) cnt[ci]++;
+            }
+        auto resync = [&]() {
+            double s = 0.0;
+            for (int ci = 0; ci < m; ++ci) if (cnt[ci] > 0) s += w[ci];
+            return s;
+        };
+        double cur = resync();
+        double best = cur;
+        uint64_t bestC = code;
+        for (uint64_t i = lo + 1; i < hi; ++i) {
+            int bit = __builtin_ctzll(i);
+            int v = bit + 1;
+            bool nowTrue = ((code >> bit) & 1ULL) == 0;
+            code ^= 1ULL << bit;
+            for (int e = O.start[v]; e < O.start[v+1]; ++e) {
+                int ci = O.occ[e] >> 1;
+                bool litTrue = nowTrue != (O.occ[e] & 1);
+                if (litTrue) { if (cnt[ci]++ == 0) cur += w[ci]; }
+                else         { if (--cnt[ci] == 0) cur -= w[ci]; }
+            }
+            if (((i - lo) & (RESYNC_STEP - 1)) == 0) {
+                cur = resync();
+                uint64_t d = done.fetch_add(RESYNC_STEP) + RESYNC_STEP;
+                if (t == 0) cerr << "brute-force progress: " << (double)d / (double)total * 100.0 << "%\r";
+            }
+            if (cur > best) { best = cur; bestC = code; }
+        }
+        bestVal[t] = best;
+        bestCode[t] = bestC;
+    };
+
+    vector<thread> pool;
+    for (int t = 1; t < threads; ++t) pool.emplace_back(worker, t);
+    worker(0);
+    for (auto &th : pool) th.join();
+    if (total > RESYNC_STEP) cerr << "brute-force progress: 100%\n";
+
+    int bt = 0;
+    for (int t = 1; t < threads; ++t) if (bestVal[t] > bestVal[bt]) bt = t;
     vector<int> bestAssign(n+1, 0);
-    vector<int> assign(n+1, 0);
-    const uint64_t PROGRESS_STEP = max<uint64_t>(1ULL << 20, total / 100ULL); 
-    for (uint64_t mask = 0; mask < total; ++mask) {
-        if ((mask & PROGRESS_STEP) == 0) {
-            if (mask != 0) {
-                double pct = (double)mask / (double)total * 100.0;
-                cerr << "brute-force progress: " << pct << "% (mask=" << mask << ")\r";
+    for (int i = 0; i < n; ++i) bestAssign[i+1] = ((bestCode[bt] >> i) & 1ULL) ? 1 : 0;
+    // report the exact value of the winner rather than the incrementally maintained one
+    return { eval_assignment(bestAssign, clauses), bestAssign };
+}
+
+// Weighted WalkSAT local search used to polish an assignment within a time budget.
+// Clauses are normalised (duplicate literals dropped, tautologies and empty clauses left out
+// since no flip changes them). Every clause keeps its number of true literals and the XOR of
+// the variables of those literals, which identifies the single true variable of a clause
+// with count 1. make[v] / brk[v] are the weights gained / lost by flipping v, and the
+// unsatisfied clauses live in an indexed list, so a flip costs O(occurrences of v).
+struct LocalSearch {
+    int n, m;
+    vector<int> cstart, clit;      // lit = 2*var + neg
+    vector<double> w;
+    vector<int> ostart, occ;       // clauses containing literal l
+    vector<int> val, tcount, truexor;
+    vector<double> make, brk;
+    vector<int> unsat, unsatPos;
+    double unsatW = 0.0;
+
+    LocalSearch(int n_, const vector<Clause>& clauses) : n(n_) {
+        vector<int> seen(2*n+2, -1);
+        cstart.push_back(0);
+        for (int ci = 0; ci < (int)clauses.size(); ++ci) {
+            const Clause &C = clauses[ci];
+            if (C.w <= 0.0 || C.lits.empty()) continue;
+            size_t base = clit.size();
+            bool taut = false;
+            for (auto &lit : C.lits) {
+                int l = 2*lit.first + (lit.second == -1 ? 1 : 0);
+                if (seen[l^1] == ci) { taut = true; break; }
+                if (seen[l] == ci) continue;
+                seen[l] = ci;
+                clit.push_back(l);
             }
+            if (taut) { clit.resize(base); continue; }
+            w.push_back(C.w);
+            cstart.push_back(clit.size());
         }
-        for (int i = 0; i < n; ++i) assign[i+1] = ((mask >> i) & 1ULL) ? 1 : 0;
-        double val = eval_assignment(assign, clauses);
-        if (val > bestVal) {
-            bestVal = val;
-            bestAssign = assign;
+        m = w.size();
+        ostart.assign(2*n+3, 0);
+        for (int l : clit) ostart[l+1]++;
+        for (int l = 1; l <= 2*n+2; ++l) ostart[l] += ostart[l-1];
+        occ.resize(clit.size());
+        vector<int> pos(ostart.begin(), ostart.end() - 1);
+        for (int c = 0; c < m; ++c)
+            for (int e = cstart[c]; e < cstart[c+1]; ++e) occ[pos[clit[e]]++] = c;
+    }
+
+    void init(const vector<int>& start) {
+        val.assign(n+1, 0);
+        for (int v = 1; v <= n && v < (int)start.size(); ++v) val[v] = start[v] == 1 ? 1 : 0;
+        tcount.assign(m, 0);
+        truexor.assign(m, 0);
+        make.assign(n+1, 0.0);
+        brk.assign(n+1, 0.0);
+        unsat.clear();
+        unsatPos.assign(m, -1);
+        unsatW = 0.0;
+        for (int c = 0; c < m; ++c) {
+            for (int e = cstart[c]; e < cstart[c+1]; ++e) {
+                int v = clit[e] >> 1;
+                if ((val[v] ^ (clit[e] & 1)) == 1) { tcount[c]++; truexor[c] ^= v; }
+            }
+            if (tcount[c] == 0) {
+                unsatPos[c] = unsat.size();
+                unsat.push_back(c);
+                unsatW += w[c];
+                for (int e = cstart[c]; e < cstart[c+1]; ++e) make[clit[e] >> 1] += w[c];
+            } else if (tcount[c] == 1) {
+                brk[truexor[c]] += w[c];
+            }
         }
     }
-    if (total > 0) cerr << "brute-force progress: 100%\n";
-    return { bestVal, bestAssign };
-}
 
-int main() {
-    ios::sync_with_stdio(false);
-    cin.tie(nullptr);
+    void flip(int v) {
+        int becameFalse = 2*v + (val[v] ? 0 : 1), becameTrue = becameFalse ^ 1;
+        val[v] ^= 1;
+        for (int e = ostart[becameTrue]; e < ostart[becameTrue+1]; ++e) {
+            int c = occ[e];
+            truexor[c] ^= v;
+            int cnt = ++tcount[c];
+            if (cnt == 1) {
+                int p = unsatPos[c], last = unsat.back();
+                unsat[p] = last; unsatPos[last] = p;
+                unsat.pop_back(); unsatPos[c] = -1;
+                unsatW -= w[c];
+                for (int f = cstart[c]; f < cstart[c+1]; ++f) make[clit[f] >> 1] -= w[c];
+                brk[v] += w[c];
+            } else if (cnt == 2) {
+                brk[truexor[c] ^ v] -= w[c];
+            }
+        }
+        for (int e = ostart[becameFalse]; e < ostart[becameFalse+1]; ++e) {
+            int c = occ[e];
+            truexor[c] ^= v;
+            int cnt = --tcount[c];
+            if (cnt == 0) {
+                unsatPos[c] = unsat.size();
+                unsat.push_back(c);
+                unsatW += w[c];
+                for (int f = cstart[c]; f < cstart[c+1]; ++f) make[clit[f] >> 1] += w[c];
+                brk[v] -= w[c];
+            } else if (cnt == 1) {
+                brk[truexor[c]] += w[c];
+            }
+        }
+    }
 
-    // input filename (placed in the same folder as the executable)
-    const char *FNAME = "input1.txt";
-    ifstream fin(FNAME);
-    if (!fin) {
-        cerr << "Failed to open input file: " << FNAME << "\n";
-        return 1;
+    // Pick a random unsatisfied clause and flip a variable of it with zero break weight if
+    // there is one, otherwise a random variable with probability noise, otherwise the one with
+    // least break weight (ties: most make weight). Returns the best assignment seen.
+    vector<int> run(const vector<int>& start, double budget_ms, uint64_t seed, double noise,
+                    uint64_t* flips_out = nullptr, const StopCondition* halt = nullptr) {
+        init(start);
+        mt19937_64 rng(seed);
+        uniform_real_distribution<double> coin(0.0, 1.0);
+        vector<int> best = val;
+        double bestW = unsatW;
+        double eps = 1e-12 * max(1.0, accumulate(w.begin(), w.end(), 0.0));
+        auto deadline = chrono::steady_clock::now() + chrono::duration<double, milli>(budget_ms);
+        uint64_t flips = 0;
+        while (!unsat.empty()) {
+            if ((flips & 1023) == 0) {
+                if (chrono::steady_clock::now() >= deadline || (halt && halt->stop())) break;
+                // the running weight drifts with repeated += / -=, recompute it from the list
+                unsatW = 0.0;
+                for (int c : unsat) unsatW += w[c];
+            }
+            int c = unsat[rng() % unsat.size()];
+            int len = cstart[c+1] - cstart[c];
+            int pick = -1;
+            double bb = numeric_limits<double>::infinity(), bm = -1.0;
+            for (int e = cstart[c]; e < cstart[c+1]; ++e) {
+                int v = clit[e] >> 1;
+                if (brk[v] < bb || (brk[v] == bb && make[v] > bm)) { bb = brk[v]; bm = make[v]; pick = v; }
+            }
+            if (bb > 0.0 && coin(rng) < noise) pick = clit[cstart[c] + rng() % len] >> 1;
+            flip(pick);
+            ++flips;
+            if (unsatW < bestW - eps) { bestW = unsatW; best = val; }
+        }
+        if (unsatW < bestW - eps) best = val;
+        if (flips_out) *flips_out = flips;
+        return best;
     }
-    istream &in = fin;
+};
 
+// Polish an assignment (assign[1..n]) with weighted WalkSAT for budget_ms milliseconds.
+// The result is never worse than start.
+vector<int> local_search(int n, const vector<Clause>& clauses, const vector<int>& start, double budget_ms,
+                         uint64_t seed = 1, double noise = 0.2, uint64_t* flips = nullptr,
+                         const StopCondition* halt = nullptr) {
+    LocalSearch LS(n, clauses);
+    vector<int> res = LS.run(start, budget_ms, seed, noise, flips, halt);
+    if (eval_assignment(res, clauses) < eval_assignment(start, clauses)) return start;
+    return res;
+}
+
+// Exact weighted Max-SAT by DPLL-style branch and bound. The search minimises the weight of
+// falsified clauses and prunes a node once falsified weight plus a lower bound reaches the
+// incumbent. Lower bounds come from inconsistent subsets found by simulated unit propagation
+// (each subset is charged its minimum residual weight, as in MaxSatz); unit clauses whose
+// weight alone would reach the incumbent are treated as hard and propagated.
+// Literals are encoded as 2*var + neg.
+struct MaxSatBnB {
     int n, m;
-    if (!(in >> n >> m)) {
-        cerr << "Failed to read n m from " << FNAME << ". Expected: n m then m lines of: w k lit...\n";
-        return 1;
+    vector<int> cstart, clit;      // clause literals, duplicates removed
+    vector<double> w;
+    vector<int> ostart, occ;       // clauses containing literal l: occ[ostart[l] .. ostart[l+1])
+    double totalW = 0.0;           // weight of all kept clauses
+    double eps;
+
+    vector<int> assign;            // -1 unassigned, 0/1
+    vector<int> nsat, nfree;       // true / unassigned literal counts per clause
+    double falsified = 0.0;
+    vector<int> trail;
+
+    double bestFalsified;
+    vector<int> bestAssign;
+    double lpBound;                // upper bound on satisfied weight of kept clauses
+    uint64_t nodes = 0;
+    bool stop = false;
+    const StopCondition* halt = nullptr;           // polled at every node (a node costs far more)
+    bool interrupted = false;
+    function<void(const vector<int>&)> onImprove;  // called with each new incumbent
+
+    // scratch for lower bound computation, validated by round stamps
+    vector<double> score, resid;
+    vector<int> residStamp, simVarStamp, simVal, reason, simCStamp, simFree, simSat, subStamp;
+    vector<int> queue, subset, units, binCount;
+    int lbRound = 0, simRound = 0, subRound = 0;
+
+    MaxSatBnB(int n_, const vector<Clause>& clauses, const vector<int>& incumbent, double lp_bound) : n(n_) {
+        // Keep only clauses that can change the objective: tautologies are always satisfied,
+        // empty and zero-weight clauses never contribute.
+        vector<int> seen(2*n+2, -1);
+        cstart.push_back(0);
+        double tautW = 0.0;
+        for (int ci = 0; ci < (int)clauses.size(); ++ci) {
+            const Clause &C = clauses[ci];
+            if (C.w <= 0.0 || C.lits.empty()) continue;
+            bool taut = false;
+            size_t base = clit.size();
+            for (auto &lit : C.lits) {
+                int l = 2*lit.first + (lit.second == -1 ? 1 : 0);
+                if (seen[l^1] == ci) { taut = true; break; }
+                if (seen[l] == ci) continue;
+                seen[l] = ci;
+                clit.push_back(l);
+            }
+            if (taut) { clit.resize(base); tautW += C.w; continue; }
+            w.push_back(C.w);
+            totalW += C.w;
+            cstart.push_back(clit.size());
+        }
+        m = w.size();
+        eps = 1e-9 * max(1.0, totalW);
+        lpBound = isfinite(lp_bound) ? lp_bound - tautW : numeric_limits<double>::infinity();
+
+        ostart.assign(2*n+3, 0);
+        for (int l : clit) ostart[l+1]++;
+        for (int l = 1; l <= 2*n+2; ++l) ostart[l] += ostart[l-1];
+        occ.resize(clit.size());
+        vector<int> pos(ostart.begin(), ostart.end() - 1);
+        for (int c = 0; c < m; ++c)
+            for (int e = cstart[c]; e < cstart[c+1]; ++e) occ[pos[clit[e]]++] = c;
+
+        assign.assign(n+1, -1);
+        nsat.assign(m, 0);
+        nfree.resize(m);
+        for (int c = 0; c < m; ++c) nfree[c] = cstart[c+1] - cstart[c];
+
+        bestAssign.assign(n+1, 0);
+        if ((int)incumbent.size() == n+1)
+            for (int v = 1; v <= n; ++v) bestAssign[v] = incumbent[v] == 1 ? 1 : 0;
+        bestFalsified = 0.0;
+        for (int c = 0; c < m; ++c) {
+            bool sat = false;
+            for (int e = cstart[c]; e < cstart[c+1] && !sat; ++e)
+                sat = (bestAssign[clit[e] >> 1] ^ (clit[e] & 1)) == 1;
+            if (!sat) bestFalsified += w[c];
+        }
+
+        score.assign(2*n+2, 0.0);
+        binCount.assign(2*n+2, 0);
+        resid.assign(m, 0.0);
+        residStamp.assign(m, 0);
+        simCStamp.assign(m, 0);
+        simFree.assign(m, 0);
+        simSat.assign(m, 0);
+        subStamp.assign(m, 0);
+        simVarStamp.assign(n+1, 0);
+        simVal.assign(n+1, 0);
+        reason.assign(n+1, -1);
     }
-    vector<Clause> clauses;
-    clauses.reserve(m);
-    for (int i = 0; i < m; ++i) {
-    double w; int k;
-    in >> w >> k;
-        Clause C; C.w = w;
-        for (int j = 0; j < k; ++j) {
-            int lit; in >> lit;
-            int var = abs(lit);
-            int sign = (lit > 0) ? 1 : -1;
-            if (var < 1 || var > n) {
-                cerr << "Literal variable index out of range: " << lit << "\n";
-                return 1;
+
+    void set_var(int v, int val) {
+        assign[v] = val;
+        trail.push_back(v);
+        int lt = 2*v + (val ? 0 : 1), lf = lt ^ 1;
+        for (int e = ostart[lt]; e < ostart[lt+1]; ++e) { nsat[occ[e]]++; nfree[occ[e]]--; }
+        for (int e = ostart[lf]; e < ostart[lf+1]; ++e) {
+            int c = occ[e];
+            if (--nfree[c] == 0 && nsat[c] == 0) falsified += w[c];
+        }
+    }
+
+    // Undo assignments down to trail size mark; falsified is restored by the caller.
+    void backtrack(size_t mark) {
+        while (trail.size() > mark) {
+            int v = trail.back(); trail.pop_back();
+            int lt = 2*v + (assign[v] ? 0 : 1), lf = lt ^ 1;
+            for (int e = ostart[lf]; e < ostart[lf+1]; ++e) nfree[occ[e]]++;
+            for (int e = ostart[lt]; e < ostart[lt+1]; ++e) { nsat[occ[e]]--; nfree[occ[e]]++; }
+            assign[v] = -1;
+        }
+    }
+
+    int free_literal(int c) {
+        for (int e = cstart[c]; e < cstart[c+1]; ++e) if (assign[clit[e] >> 1] == -1) return clit[e];
+        return -1;
+    }
+
+    // A unit clause heavy enough that falsifying it reaches the incumbent must be satisfied.
+    // Returns false if the node can be pruned.
+    bool propagate_hard_units() {
+        bool changed = true;
+        while (changed) {
+            changed = false;
+            if (falsified >= bestFalsified - eps) return false;
+            for (int c = 0; c < m; ++c) {
+                if (nsat[c] != 0 || nfree[c] != 1) continue;
+                if (falsified + w[c] < bestFalsified - eps) continue;
+                int l = free_literal(c);
+                set_var(l >> 1, (l & 1) ? 0 : 1);
+                changed = true;
+                if (falsified >= bestFalsified - eps) return false;
+            }
+        }
+        return true;
+    }
+
+    double residual(int c) {
+        if (residStamp[c] != lbRound) { residStamp[c] = lbRound; resid[c] = w[c]; }
+        return resid[c];
+    }
+
+    bool sim_assigned(int v) { return simVarStamp[v] == simRound; }
+
+    void sim_set(int l, int why) {
+        int v = l >> 1;
+        simVarStamp[v] = simRound;
+        simVal[v] = (l & 1) ? 0 : 1;
+        reason[v] = why;
+    }
+
+    // Unit propagation over the open clauses with positive residual weight, without touching
+    // the real assignment. If assume >= 0 that literal is set first as a decision.
+    // Returns a clause falsified by propagation, or -1.
+    int simulate_up(int assume) {
+        ++simRound;
+        queue.clear();
+        int qi = 0;
+        if (assume >= 0) {
+            sim_set(assume, -1);
+            queue.push_back(~assume);
+        }
+        for (int c : units) if (residual(c) > eps) queue.push_back(c);
+        for (; qi < (int)queue.size(); ++qi) {
+            int l;
+            if (queue[qi] < 0) {
+                l = ~queue[qi];
+            } else {
+                int c = queue[qi];
+                if (simCStamp[c] == simRound && simSat[c]) continue;
+                l = -1;
+                for (int e = cstart[c]; e < cstart[c+1]; ++e) {
+                    int v = clit[e] >> 1;
+                    if (assign[v] != -1) continue;
+                    if (sim_assigned(v)) {
+                        if ((simVal[v] ^ (clit[e] & 1)) == 1) { l = -2; break; }
+                        continue;
+                    }
+                    l = clit[e];
+                    break;
+                }
+                if (l == -2) continue;
+                if (l == -1) return c;
+                sim_set(l, c);
+            }
+            for (int e = ostart[l]; e < ostart[l+1]; ++e) {
+                int d = occ[e];
+                if (simCStamp[d] != simRound) { simCStamp[d] = simRound; simFree[d] = nfree[d]; }
+                simSat[d] = 1;
+            }
+            for (int e = ostart[l^1]; e < ostart[(l^1)+1]; ++e) {
+                int d = occ[e];
+                if (nsat[d] != 0 || residual(d) <= eps) continue;
+                if (simCStamp[d] != simRound) { simCStamp[d] = simRound; simFree[d] = nfree[d]; simSat[d] = 0; }
+                if (simSat[d]) continue;
+                if (--simFree[d] == 0) return d;
+                if (simFree[d] == 1) queue.push_back(d);
+            }
+        }
+        return -1;
+    }
+
+    // Add the conflict clause k and the reasons of every propagated literal it depends on.
+    void collect_subset(int k) {
+        if (subStamp[k] != subRound) { subStamp[k] = subRound; subset.push_back(k); }
+        for (size_t si = 0; si < subset.size(); ++si) {
+            int c = subset[si];
+            for (int e = cstart[c]; e < cstart[c+1]; ++e) {
+                int v = clit[e] >> 1;
+                if (assign[v] != -1 || !sim_assigned(v) || reason[v] < 0) continue;
+                int r = reason[v];
+                if (subStamp[r] != subRound) { subStamp[r] = subRound; subset.push_back(r); }
+            }
+        }
+    }
+
+    double charge_subset() {
+        double delta = numeric_limits<double>::infinity();
+        for (int c : subset) delta = min(delta, residual(c));
+        for (int c : subset) resid[c] -= delta;
+        return delta;
+    }
+
+    // Underestimation of the weight still to be falsified below this node: disjoint (in
+    // residual weight) inconsistent subsets from unit propagation, then from failed literals
+    // on the candidate variables (both polarities lead to a conflict).
+    double lower_bound(const vector<int>& candidates) {
+        ++lbRound;
+        units.clear();
+        for (int c = 0; c < m; ++c) if (nsat[c] == 0 && nfree[c] == 1) units.push_back(c);
+        double lb = 0.0;
+        while (falsified + lb < bestFalsified - eps) {
+            int k = simulate_up(-1);
+            if (k < 0) break;
+            ++subRound;
+            subset.clear();
+            collect_subset(k);
+            lb += charge_subset();
+        }
+        bool found = true;
+        while (found && falsified + lb < bestFalsified - eps) {
+            found = false;
+            for (int v : candidates) {
+                if (falsified + lb >= bestFalsified - eps) break;
+                int k1 = simulate_up(2*v);
+                if (k1 < 0) continue;
+                ++subRound;
+                subset.clear();
+                collect_subset(k1);
+                int k2 = simulate_up(2*v + 1);
+                if (k2 < 0) continue;
+                collect_subset(k2);
+                lb += charge_subset();
+                found = true;
+            }
+        }
+        return lb;
+    }
+
+    void search() {
+        if (stop) return;
+        if (halt && halt->stop()) { stop = interrupted = true; return; }
+        ++nodes;
+        size_t mark = trail.size();
+        double savedF = falsified;
+        if (propagate_hard_units()) {
+            // Jeroslow-Wang style literal scores over the open clauses; variables with binary
+            // clauses on both polarities are the failed-literal candidates
+            fill(score.begin(), score.end(), 0.0);
+            fill(binCount.begin(), binCount.end(), 0);
+            bool open = false;
+            for (int c = 0; c < m; ++c) {
+                if (nsat[c] != 0 || nfree[c] == 0) continue;
+                open = true;
+                double s = ldexp(w[c], -min(nfree[c], 60));
+                for (int e = cstart[c]; e < cstart[c+1]; ++e)
+                    if (assign[clit[e] >> 1] == -1) {
+                        score[clit[e]] += s;
+                        if (nfree[c] == 2) binCount[clit[e]]++;
+                    }
+            }
+            if (!open) {
+                bestFalsified = falsified;
+                for (int v = 1; v <= n; ++v) bestAssign[v] = assign[v] == 1 ? 1 : 0;
+                if (onImprove) onImprove(bestAssign);
+                if (totalW - bestFalsified >= lpBound - eps) stop = true;
+            } else {
+                vector<int> candidates;
+                for (int v = 1; v <= n; ++v)
+                    if (assign[v] == -1 && binCount[2*v] > 0 && binCount[2*v+1] > 0) candidates.push_back(v);
+                if (falsified + lower_bound(candidates) < bestFalsified - eps) {
+                    int bv = -1;
+                    double bs = -1.0;
+                    for (int v = 1; v <= n; ++v) {
+                        if (assign[v] != -1) continue;
+                        double s = score[2*v] + score[2*v+1];
+                        if (s > bs) { bs = s; bv = v; }
+                    }
+                    int first = score[2*bv] >= score[2*bv+1] ? 1 : 0;
+                    size_t mark2 = trail.size();
+                    double f2 = falsified;
+                    set_var(bv, first);
+                    search();
+                    backtrack(mark2);
+                    falsified = f2;
+                    set_var(bv, 1 - first);
+                    search();
+                }
+            }
+        }
+        backtrack(mark);
+        falsified = savedF;
+    }
+};
+
+// Exact Max-SAT via branch and bound. incumbent (assign[1..n], may be empty) seeds the upper
+// bound; lp_bound is the LP relaxation optimum (or +infinity) and stops the search as soon as
+// the incumbent reaches it.
+// With halt the search may end early; proven then tells whether the result is optimal.
+pair<double, vector<int>> branch_and_bound_opt(int n, const vector<Clause>& clauses,
+                                               const vector<int>& incumbent, double lp_bound,
+                                               uint64_t* nodes = nullptr, const StopCondition* halt = nullptr,
+                                               bool* proven = nullptr,
+                                               function<void(const vector<int>&)> on_improve = nullptr) {
+    MaxSatBnB S(n, clauses, incumbent, lp_bound);
+    S.halt = halt;
+    S.onImprove = move(on_improve);
+    if (S.totalW - S.bestFalsified < S.lpBound - S.eps) S.search();
+    if (nodes) *nodes = S.nodes;
+    if (proven) *proven = !S.interrupted;
+    return { eval_assignment(S.bestAssign, clauses), S.bestAssign };
+}
+
+// ---------------------------------------------------------------------------------------
+// Preprocessing
+//
+// preprocess() shrinks an instance before any solver sees it:
+//   - literals are sorted and deduplicated, tautologies and zero-weight/empty clauses dropped,
+//   - duplicate clauses are merged by summing their weights,
+//   - complementary unit clauses (l, a), (-l, b) become (l, a - b) plus min(a, b) satisfied,
+//   - a literal l is fixed true when it is pure or when the weight of the unit clause (l) is
+//     at least the weight of all clauses containing -l (flipping to l can never lose),
+//   - a clause D is dropped when another clause C with C subset of D must be satisfied by
+//     every optimum, i.e. w(C) exceeds the weight of all clauses containing the negation of
+//     one of C's literals (hard clauses always qualify).
+// Fixing and merging run to a fixpoint first; subsumption runs afterwards and is followed by
+// pure-literal fixing only, which never shrinks a clause, so the subsuming clauses keep the
+// property that made the removals safe. restore() maps reduced assignments back.
+// ---------------------------------------------------------------------------------------
+
+struct Preprocessed {
+    int n = 0;                    // reduced variable count
+    vector<Clause> clauses;       // reduced clauses over variables 1..n
+    vector<int> origOf;           // reduced variable -> original variable
+    vector<int> fixedVal;         // original variable -> 0/1 if fixed or unused, -1 if kept
+    double satWeight = 0.0;       // weight satisfied regardless of the reduced assignment
+    int tautologies = 0, duplicates = 0, fixedVars = 0, subsumed = 0;
+
+    // assign[1..n] over the reduced variables -> assignment over the original variables
+    vector<int> restore(const vector<int>& assign) const {
+        vector<int> out(fixedVal.size(), 0);
+        for (size_t v = 1; v < fixedVal.size(); ++v) out[v] = fixedVal[v] == 1 ? 1 : 0;
+        for (int v = 1; v <= n; ++v) out[origOf[v]] = assign[v] == 1 ? 1 : 0;
+        return out;
+    }
+
+    vector<double> restore_probs(const vector<double>& probs) const {
+        vector<double> out(fixedVal.size(), 0.0);
+        for (size_t v = 1; v < fixedVal.size(); ++v) out[v] = fixedVal[v] == 1 ? 1.0 : 0.0;
+        for (int v = 1; v <= n; ++v) out[origOf[v]] = probs[v];
+        return out;
+    }
+};
+
+// The instance unchanged, for running without preprocessing.
+Preprocessed identity_instance(int n, const vector<Clause>& clauses) {
+    Preprocessed P;
+    P.n = n;
+    P.clauses = clauses;
+    P.origOf.resize(n+1);
+    for (int v = 0; v <= n; ++v) P.origOf[v] = v;
+    P.fixedVal.assign(n+1, -1);
+    return P;
+}
+
+Preprocessed preprocess(int n, const vector<Clause>& input) {
+    Preprocessed P;
+    P.fixedVal.assign(n+1, -1);
+
+    // working clauses: sorted literal vectors (lit = 2*var + neg) with weights
+    vector<vector<int>> lits;
+    vector<double> w;
+    vector<char> alive;
+    for (auto &C : input) {
+        if (C.w <= 0.0 || C.lits.empty()) continue;
+        vector<int> L;
+        L.reserve(C.lits.size());
+        for (auto &lit : C.lits) L.push_back(2*lit.first + (lit.second == -1 ? 1 : 0));
+        sort(L.begin(), L.end());
+        L.erase(unique(L.begin(), L.end()), L.end());
+        bool taut = false;
+        for (size_t i = 1; i < L.size(); ++i) if ((L[i] ^ 1) == L[i-1]) { taut = true; break; }
+        if (taut) { P.satWeight += C.w; P.tautologies++; continue; }
+        lits.push_back(move(L));
+        w.push_back(C.w);
+        alive.push_back(1);
+    }
+
+    vector<vector<int>> occ;           // literal -> clause ids (may contain dead entries)
+    vector<int> occCount;              // literal -> number of alive clauses containing it
+    vector<int> unitOf;                // literal -> alive unit clause (l), or -1
+    auto rebuild = [&]() {
+        // merge duplicates among alive clauses and rebuild the occurrence lists
+        auto hash = [&](int c) {
+            uint64_t h = 1469598103934665603ULL;
+            for (int l : lits[c]) h = (h ^ (uint64_t)l) * 1099511628211ULL;
+            return (size_t)h;
+        };
+        auto same = [&](int x, int y) { return lits[x] == lits[y]; };
+        unordered_set<int, decltype(hash), decltype(same)> seen(lits.size() * 2, hash, same);
+        for (size_t c = 0; c < lits.size(); ++c) {
+            if (!alive[c]) continue;
+            auto ins = seen.insert((int)c);
+            if (!ins.second) { w[*ins.first] += w[c]; alive[c] = 0; P.duplicates++; }
+        }
+        occ.assign(2*n+2, {});
+        occCount.assign(2*n+2, 0);
+        unitOf.assign(2*n+2, -1);
+        for (size_t c = 0; c < lits.size(); ++c) {
+            if (!alive[c]) continue;
+            for (int l : lits[c]) { occ[l].push_back(c); occCount[l]++; }
+            if (lits[c].size() == 1) unitOf[lits[c][0]] = c;
+        }
+    };
+    auto kill = [&](int c) {
+        alive[c] = 0;
+        for (int l : lits[c]) occCount[l]--;
+        if (lits[c].size() == 1 && unitOf[lits[c][0]] == c) unitOf[lits[c][0]] = -1;
+    };
+    auto weight_of = [&](int l) {
+        double s = 0.0;
+        for (int c : occ[l]) if (alive[c]) s += w[c];
+        return s;
+    };
+
+    deque<int> work;
+    vector<char> queued(n+1, 0);
+    auto touch = [&](int c) {
+        for (int l : lits[c]) if (!queued[l >> 1]) { queued[l >> 1] = 1; work.push_back(l >> 1); }
+    };
+    // Fix literal l true: clauses containing l are satisfied, -l is removed from the rest.
+    auto fix = [&](int l) {
+        int v = l >> 1;
+        P.fixedVal[v] = (l & 1) ? 0 : 1;
+        P.fixedVars++;
+        for (int c : occ[l]) if (alive[c]) { P.satWeight += w[c]; kill(c); touch(c); }
+        for (int c : occ[l^1]) {
+            if (!alive[c]) continue;
+            occCount[l^1]--;
+            auto &L = lits[c];
+            L.erase(find(L.begin(), L.end(), l^1));
+            if (L.empty()) { alive[c] = 0; continue; }
+            if (L.size() == 1) {
+                int u = unitOf[L[0]];
+                if (u >= 0) { w[u] += w[c]; kill(c); P.duplicates++; c = u; }
+                else unitOf[L[0]] = c;
             }
-            C.lits.emplace_back(var, sign);
+            touch(c);
+        }
+    };
+    auto check_var = [&](int v, bool allowUnits) {
+        if (P.fixedVal[v] != -1) return false;
+        for (int l : {2*v, 2*v+1}) {
+            if (occCount[l] > 0 && occCount[l^1] == 0) { fix(l); return true; }
+        }
+        if (!allowUnits) return false;
+        int a = unitOf[2*v], b = unitOf[2*v+1];
+        if (a >= 0 && b >= 0) {
+            // exactly one of the two units is satisfied
+            int keep = w[a] >= w[b] ? a : b, drop = keep == a ? b : a;
+            P.satWeight += w[drop];
+            w[keep] -= w[drop];
+            kill(drop);
+            if (w[keep] <= 0.0) kill(keep);
+            touch(keep);
+            return true;
+        }
+        for (int l : {2*v, 2*v+1}) {
+            int u = unitOf[l];
+            if (u >= 0 && w[u] >= weight_of(l^1)) { fix(l); return true; }
+        }
+        return false;
+    };
+    auto run_worklist = [&](bool allowUnits) {
+        bool changed = false;
+        while (!work.empty()) {
+            int v = work.front(); work.pop_front();
+            queued[v] = 0;
+            if (check_var(v, allowUnits)) {
+                changed = true;
+                if (!queued[v]) { queued[v] = 1; work.push_back(v); }
+            }
+        }
+        return changed;
+    };
+    auto enqueue_all = [&]() {
+        for (int v = 1; v <= n; ++v) if (!queued[v]) { queued[v] = 1; work.push_back(v); }
+    };
+
+    // 1) units, pure literals and duplicate merging to a fixpoint
+    for (;;) {
+        rebuild();
+        enqueue_all();
+        if (!run_worklist(true)) break;
+    }
+
+    // 2) subsumption by clauses every optimum satisfies
+    vector<double> litW(2*n+2, 0.0);
+    for (int l = 2; l < 2*n+2; ++l) litW[l] = weight_of(l);
+    vector<int> order;                 // alive clauses, shortest first (counting sort)
+    {
+        vector<int> bySize;
+        for (size_t c = 0; c < lits.size(); ++c)
+            if (alive[c]) { size_t k = lits[c].size(); if (k >= bySize.size()) bySize.resize(k + 1, 0); bySize[k]++; }
+        for (size_t k = 1; k < bySize.size(); ++k) bySize[k] += bySize[k-1];
+        order.resize(bySize.empty() ? 0 : bySize.back());
+        for (size_t c = lits.size(); c-- > 0; )
+            if (alive[c]) order[--bySize[lits[c].size()]] = c;
+    }
+    vector<int> mark(2*n+2, -1);
+    for (int c : order) {
+        if (!alive[c]) continue;
+        const auto &L = lits[c];
+        double need = numeric_limits<double>::infinity();
+        for (int l : L) need = min(need, litW[l^1]);
+        if (w[c] <= need) continue;
+        int pivot = L[0];
+        for (int l : L) if (occCount[l] < occCount[pivot]) pivot = l;
+        for (int l : L) mark[l] = c;
+        for (int d : occ[pivot]) {
+            if (d == c || !alive[d] || lits[d].size() < L.size()) continue;
+            int hit = 0;
+            for (int l : lits[d]) hit += mark[l] == c;
+            if (hit < (int)L.size()) continue;
+            P.satWeight += w[d];
+            for (int l : lits[d]) litW[l] -= w[d];
+            kill(d);
+            P.subsumed++;
+            touch(d);
         }
-        clauses.push_back(move(C));
     }
 
-    // 1) derandomized 1/2
+    // 3) pure literals exposed by the removals
+    run_worklist(false);
+
+    // compact: renumber the variables that still occur
+    vector<int> newOf(n+1, 0);
+    P.origOf.push_back(0);
+    for (size_t c = 0; c < lits.size(); ++c) {
+        if (!alive[c]) continue;
+        for (int l : lits[c]) {
+            int v = l >> 1;
+            if (!newOf[v]) { newOf[v] = ++P.n; P.origOf.push_back(v); }
+        }
+    }
+    for (int v = 1; v <= n; ++v) if (!newOf[v] && P.fixedVal[v] == -1) P.fixedVal[v] = 0;
+    for (size_t c = 0; c < lits.size(); ++c) {
+        if (!alive[c]) continue;
+        Clause C;
+        C.w = w[c];
+        for (int l : lits[c]) C.lits.emplace_back(newOf[l >> 1], (l & 1) ? -1 : 1);
+        P.clauses.push_back(move(C));
+    }
+    return P;
+}
+
+// ---------------------------------------------------------------------------------------
+// Instance input
+//
+// Three formats are accepted and detected from the first non-comment line:
+//   legacy      "n m" followed by m lines "w k l1 .. lk" (the format described above)
+//   DIMACS      "p wcnf n m [top]" then "w l1 .. lk 0" per clause (hard if w >= top),
+//               or "p cnf n m" then "l1 .. lk 0" with unit weights
+//   WCNF 2022   no header; "h l1 .. lk 0" for hard clauses and "w l1 .. lk 0" for soft ones
+// Lines starting with 'c' are comments in the DIMACS formats. The file is memory-mapped and
+// numbers are tokenized by hand, so parsing does not go through iostreams or the locale.
+// ---------------------------------------------------------------------------------------
+
+struct MappedFile {
+    const char* data = nullptr;
+    size_t size = 0;
+#ifdef _WIN32
+    vector<char> buf;
+#else
+    void* map = nullptr;
+#endif
+
+    bool open(const char* path, string& err) {
+#ifdef _WIN32
+        ifstream f(path, ios::binary);
+        if (!f) { err = string("Failed to open input file: ") + path; return false; }
+        buf.assign(istreambuf_iterator<char>(f), istreambuf_iterator<char>());
+        data = buf.data();
+        size = buf.size();
+#else
+        int fd = ::open(path, O_RDONLY);
+        if (fd < 0) { err = string("Failed to open input file: ") + path; return false; }
+        struct stat st;
+        if (fstat(fd, &st) != 0) { ::close(fd); err = string("Failed to stat input file: ") + path; return false; }
+        size = (size_t)st.st_size;
+        if (size > 0) {
+            map = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (map == MAP_FAILED) { map = nullptr; ::close(fd); err = string("Failed to map input file: ") + path; return false; }
+            madvise(map, size, MADV_SEQUENTIAL);
+            data = (const char*)map;
+        }
+        ::close(fd);
+#endif
+        return true;
+    }
+
+    ~MappedFile() {
+#ifndef _WIN32
+        if (map) munmap(map, size);
+#endif
+    }
+};
+
+struct Scanner {
+    const char* p;
+    const char* end;
+    const char* begin;
+
+    Scanner(const char* b, size_t len) : p(b), end(b + len), begin(b) {}
+
+    static bool is_space(char c) { return c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f'; }
+    void skip_blanks() { while (p < end && is_space(*p)) ++p; }
+    void skip_ws() { while (p < end && (is_space(*p) || *p == '\n')) ++p; }
+    void skip_line() { while (p < end && *p != '\n') ++p; if (p < end) ++p; }
+    bool at_eol() { skip_blanks(); return p >= end || *p == '\n'; }
+    // skip blank lines and DIMACS comment lines
+    void skip_comments() {
+        for (;;) {
+            skip_ws();
+            if (p < end && *p == 'c') skip_line(); else return;
+        }
+    }
+    int line() const { return 1 + (int)count(begin, p, '\n'); }
+
+    bool read_int(long long& out) {
+        skip_ws();
+        bool neg = false;
+        if (p < end && (*p == '-' || *p == '+')) neg = *p++ == '-';
+        if (p >= end || *p < '0' || *p > '9') return false;
+        long long v = 0;
+        while (p < end && *p >= '0' && *p <= '9') v = v * 10 + (*p++ - '0');
+        out = neg ? -v : v;
+        return true;
+    }
+
+    // Decimal mantissa times an exact power of ten (exact for mantissa < 2^53 and |exp| <= 22);
+    // anything outside that range goes through strtod.
+    bool read_double(double& out) {
+        static const double POW10[] = {1e0,1e1,1e2,1e3,1e4,1e5,1e6,1e7,1e8,1e9,1e10,1e11,
+                                       1e12,1e13,1e14,1e15,1e16,1e17,1e18,1e19,1e20,1e21,1e22};
+        skip_ws();
+        const char* start = p;
+        bool neg = false;
+        if (p < end && (*p == '-' || *p == '+')) neg = *p++ == '-';
+        uint64_t mant = 0;
+        int digits = 0, exp10 = 0;
+        bool any = false;
+        while (p < end && *p >= '0' && *p <= '9') {
+            any = true;
+            if (digits < 19) { mant = mant * 10 + (*p - '0'); if (mant) ++digits; } else ++exp10;
+            ++p;
+        }
+        if (p < end && *p == '.') {
+            ++p;
+            while (p < end && *p >= '0' && *p <= '9') {
+                any = true;
+                if (digits < 19) { mant = mant * 10 + (*p - '0'); if (mant) ++digits; --exp10; }
+                ++p;
+            }
+        }
+        if (!any) return false;
+        if (p < end && (*p == 'e' || *p == 'E')) {
+            ++p;
+            long long e;
+            if (!read_int(e)) return false;
+            exp10 += (int)max(-100000LL, min(100000LL, e));
+        }
+        if (mant < (1ULL << 53) && exp10 >= -22 && exp10 <= 22) {
+            double v = (double)mant;
+            v = exp10 >= 0 ? v * POW10[exp10] : v / POW10[-exp10];
+            out = neg ? -v : v;
+        } else {
+            string tok(start, p);
+            out = strtod(tok.c_str(), nullptr);
+        }
+        return true;
+    }
+};
+
+struct InstanceInfo {
+    string format;          // "legacy", "wcnf", "cnf" or "wcnf2022"
+    int n = 0;
+    long long m = 0;
+    long long hard = 0;     // number of hard clauses
+    double hard_weight = 0; // weight that stands in for hard clauses (0 if there are none)
+};
+
+// Parse an instance, handing each clause to sink(w, hard, lits, k) with signed DIMACS literals.
+// Hard clauses of the 2022 format are passed with w = -1 and must be given info.hard_weight
+// (one more than the total soft weight) once parsing is finished. Returns false on error.
+template <class Sink>
+bool parse_instance(const char* data, size_t len, Sink&& sink, InstanceInfo& info, string& err) {
+    Scanner S(data, len);
+    vector<int> lits;
+    double softSum = 0.0;
+    auto fail = [&](const string& msg) {
+        err = "line " + to_string(S.line()) + ": " + msg;
+        return false;
+    };
+    auto read_lits_until_zero = [&](int nmax) {
+        lits.clear();
+        long long l;
+        for (;;) {
+            if (!S.read_int(l)) return false;
+            if (l == 0) return true;
+            if (nmax > 0 && (l < -nmax || l > nmax)) return false;
+            if (l > INT_MAX || l < -INT_MAX) return false;
+            lits.push_back((int)l);
+            info.n = max(info.n, (int)llabs(l));
+        }
+    };
+
+    S.skip_comments();
+    if (S.p < S.end && *S.p == 'p') {
+        ++S.p;
+        S.skip_blanks();
+        const char* f = S.p;
+        while (S.p < S.end && !Scanner::is_space(*S.p) && *S.p != '\n') ++S.p;
+        string fmt(f, S.p);
+        if (fmt != "wcnf" && fmt != "cnf") return fail("unsupported problem type '" + fmt + "'");
+        long long n, m;
+        if (!S.read_int(n) || !S.read_int(m) || n < 0 || m < 0 || n > INT_MAX)
+            return fail("malformed p line, expected: p " + fmt + " n m [top]");
+        double top = numeric_limits<double>::infinity();
+        if (fmt == "wcnf" && !S.at_eol() && !S.read_double(top)) return fail("malformed top weight");
+        info.format = fmt;
+        sink.begin((int)n, m);
+        for (;;) {
+            S.skip_comments();
+            if (S.p >= S.end) break;
+            double w = 1.0;
+            if (fmt == "wcnf" && !S.read_double(w)) return fail("expected clause weight");
+            if (!read_lits_until_zero((int)n)) return fail("bad literal (expected integers in [-n,n] ending with 0)");
+            bool hard = w >= top;
+            if (hard) info.hard++;
+            sink.clause(w, hard, lits.data(), (int)lits.size());
+            info.m++;
+        }
+        info.n = (int)n;
+        if (info.hard > 0) info.hard_weight = top;
+        return true;
+    }
+
+    // Legacy "n m" header: exactly two integers on the first line, the second one nonzero
+    // (a 2022 soft line also ends in an integer but that one is always the terminating 0).
+    const char* save = S.p;
+    long long a, b;
+    bool legacy = false;
+    if (S.read_int(a) && S.read_int(b) && S.at_eol()) legacy = b != 0 || (S.skip_ws(), S.p >= S.end);
+    if (legacy) {
+        if (a < 0 || b < 0 || a > INT_MAX) return fail("invalid n m header");
+        int n = (int)a;
+        info.format = "legacy";
+        sink.begin(n, b);
+        for (long long i = 0; i < b; ++i) {
+            double w;
+            long long k, l;
+            if (!S.read_double(w) || !S.read_int(k) || k < 0)
+                return fail("failed to read clause " + to_string(i + 1) + ", expected: w k lit...");
+            lits.clear();
+            for (long long j = 0; j < k; ++j) {
+                if (!S.read_int(l)) return fail("failed to read literal");
+                if (l == 0 || l < -n || l > n) return fail("Literal variable index out of range: " + to_string(l));
+                lits.push_back((int)l);
+            }
+            sink.clause(w, false, lits.data(), (int)lits.size());
+            info.m++;
+        }
+        info.n = n;
+        return true;
+    }
+
+    // 2022 WCNF: the number of variables is the largest index seen.
+    S.p = save;
+    info.format = "wcnf2022";
+    sink.begin(0, 0);
+    for (;;) {
+        S.skip_comments();
+        if (S.p >= S.end) break;
+        bool hard = false;
+        double w = -1.0;
+        if (*S.p == 'h') { hard = true; ++S.p; }
+        else if (!S.read_double(w)) return fail("expected 'h' or a clause weight");
+        if (!read_lits_until_zero(0)) return fail("bad literal (expected integers ending with 0)");
+        if (hard) info.hard++; else softSum += w;
+        sink.clause(w, hard, lits.data(), (int)lits.size());
+        info.m++;
+    }
+    if (info.hard > 0) info.hard_weight = softSum + 1.0;
+    return true;
+}
+
+// Load an instance from path into clauses; hard clauses get info.hard_weight. Repeated
+// literals of a clause are dropped (the fused derandomization counts each literal once).
+bool load_instance(const char* path, int& n, vector<Clause>& clauses, InstanceInfo& info, string& err,
+                   pmr::memory_resource* lits_mr = pmr::get_default_resource()) {
+    MappedFile F;
+    if (!F.open(path, err)) return false;
+    vector<size_t> hardIdx;
+    struct VectorSink {
+        vector<Clause>& out;
+        vector<size_t>& hardIdx;
+        pmr::memory_resource* mr;
+        vector<int> L;
+        void begin(int, long long m) { out.reserve((size_t)m); }
+        void clause(double w, bool hard, const int* lits, int k) {
+            if (hard) hardIdx.push_back(out.size());
+            out.push_back(Clause{w, pmr::vector<pair<int,int>>(mr)});
+            Clause &C = out.back();
+            L.assign(lits, lits + k);
+            sort(L.begin(), L.end(), [](int a, int b) { return abs(a) != abs(b) ? abs(a) < abs(b) : a < b; });
+            L.erase(unique(L.begin(), L.end()), L.end());
+            C.lits.reserve(L.size());
+            for (int l : L) C.lits.emplace_back(abs(l), l > 0 ? 1 : -1);
+        }
+    } sink{clauses, hardIdx, lits_mr, {}};
+    clauses.clear();
+    if (!parse_instance(F.data, F.size, sink, info, err)) {
+        err = string(path) + ": " + err;
+        return false;
+    }
+    for (size_t i : hardIdx) clauses[i].w = info.hard_weight;
+    n = info.n;
+    return true;
+}
+
+// ---------------------------------------------------------------------------------------
+// Streaming derandomization (--stream)
+//
+// For instances that do not fit in memory the text instance is converted once into a binary
+// clause file (literals deduplicated, tautologies folded into a constant) and derand_half is
+// replayed with O(n) RAM. Variables are decided in blocks [lo, hi), one sequential pass over
+// the clause file per block. In such a pass every clause is already decided by the variables
+// below lo or has u unassigned literals above hi, and for p = 1/2:
+//   - a clause with one literal of the block adds +-w * 2^-u to that variable's bias
+//     E[W | v=1] - E[W | v=0], independently of the other decisions in the block,
+//   - a clause with several block literals is spilled as (w, u, block literals).
+// The block is then decided in order from the biases plus the spilled clauses, which are
+// loaded when they fit in the memory budget and otherwise streamed again recursively with
+// smaller sub-blocks (a one-variable block never spills). The decisions are exactly those of
+// the in-memory method of conditional expectations.
+// ---------------------------------------------------------------------------------------
+
+// Anonymous temporary file, in dir if given (created and immediately unlinked).
+FILE* open_temp_file(const string& dir) {
+#ifndef _WIN32
+    if (!dir.empty()) {
+        string tmpl = dir + "/maxsat_stream_XXXXXX";
+        vector<char> name(tmpl.begin(), tmpl.end());
+        name.push_back('\0');
+        int fd = mkstemp(name.data());
+        if (fd < 0) return nullptr;
+        unlink(name.data());
+        return fdopen(fd, "w+b");
+    }
+#endif
+    return tmpfile();
+}
+
+// Record layout: double w (negative = hard clause, weight supplied by the reader),
+// uint32 tail (unassigned literals outside the block), uint32 k, int32 lits[k].
+struct ClauseFileWriter {
+    FILE* f;
+    vector<char> buf;
+    size_t len = 0;
+    uint64_t bytes = 0, count = 0;
+
+    explicit ClauseFileWriter(FILE* out, size_t cap = 1 << 22) : f(out), buf(cap) {}
+
+    void put(double w, uint32_t tail, const int* lits, uint32_t k) {
+        size_t need = 16 + 4 * (size_t)k;
+        if (len + need > buf.size()) flush();
+        if (need > buf.size()) buf.resize(need);
+        char* p = buf.data() + len;
+        memcpy(p, &w, 8);
+        memcpy(p + 8, &tail, 4);
+        memcpy(p + 12, &k, 4);
+        memcpy(p + 16, lits, 4 * (size_t)k);
+        len += need;
+        bytes += need;
+        count++;
+    }
+
+    bool flush() {
+        bool ok = len == 0 || fwrite(buf.data(), 1, len, f) == len;
+        len = 0;
+        return ok;
+    }
+};
+
+struct ClauseFileReader {
+    FILE* f;
+    vector<char> buf;
+    size_t pos = 0, len = 0;
+
+    explicit ClauseFileReader(FILE* in, size_t cap = 1 << 22) : f(in), buf(cap) { rewind(); }
+
+    void rewind() { fseek(f, 0, SEEK_SET); pos = len = 0; }
+
+    bool fill(size_t need) {
+        if (len - pos >= need) return true;
+        memmove(buf.data(), buf.data() + pos, len - pos);
+        len -= pos;
+        pos = 0;
+        if (need > buf.size()) buf.resize(need);
+        len += fread(buf.data() + len, 1, buf.size() - len, f);
+        return len >= need;
+    }
+
+    bool next(double& w, uint32_t& tail, uint32_t& k, const int*& lits) {
+        if (!fill(16)) return false;
+        const char* p = buf.data() + pos;
+        memcpy(&w, p, 8);
+        memcpy(&tail, p + 8, 4);
+        memcpy(&k, p + 12, 4);
+        if (!fill(16 + 4 * (size_t)k)) return false;
+        p = buf.data() + pos;
+        lits = reinterpret_cast<const int*>(p + 16);
+        pos += 16 + 4 * (size_t)k;
+        return true;
+    }
+};
+
+struct StreamDerand {
+    int n;
+    double hardWeight;
+    size_t memBudget;
+    string tmpDir;
+    vector<signed char> assign;   // -1 unassigned, 0/1
+    uint64_t passes = 0, spillBytes = 0;
+
+    double weight(double w) const { return w < 0.0 ? hardWeight : w; }
+
+    bool lit_true(int l) const { return assign[abs(l)] == (l > 0 ? 1 : 0); }
+
+    // Decide [lo, hi) from the per-variable biases and clauses that are all in memory.
+    void decide_in_memory(int lo, int hi, vector<double>& bias, const vector<double>& w,
+                          const vector<uint32_t>& tail, const vector<size_t>& start, const vector<int>& lits) {
+        int B = hi - lo;
+        size_t m = w.size();
+        vector<size_t> ostart(B + 1, 0);
+        for (int l : lits) ostart[abs(l) - lo + 1]++;
+        for (int b = 0; b < B; ++b) ostart[b+1] += ostart[b];
+        vector<pair<uint32_t,int>> occ(lits.size());   // (clause, literal)
+        vector<size_t> pos(ostart.begin(), ostart.end() - 1);
+        for (size_t c = 0; c < m; ++c)
+            for (size_t e = start[c]; e < start[c+1]; ++e) occ[pos[abs(lits[e]) - lo]++] = { (uint32_t)c, lits[e] };
+        vector<uint32_t> freeCnt(m);
+        vector<char> sat(m, 0);
+        for (size_t c = 0; c < m; ++c) freeCnt[c] = (uint32_t)(start[c+1] - start[c]) + tail[c];
+        for (int b = 0; b < B; ++b) {
+            double d = bias[b];
+            for (size_t e = ostart[b]; e < ostart[b+1]; ++e) {
+                uint32_t c = occ[e].first;
+                if (sat[c]) continue;
+                double x = ldexp(w[c], -(int)min<uint32_t>(freeCnt[c] - 1, 2000));
+                d += occ[e].second > 0 ? x : -x;
+            }
+            int val = d > 0.0 ? 1 : 0;
+            assign[lo + b] = val;
+            for (size_t e = ostart[b]; e < ostart[b+1]; ++e) {
+                uint32_t c = occ[e].first;
+                freeCnt[c]--;
+                if ((occ[e].second > 0) == (val == 1)) sat[c] = 1;
+            }
+        }
+    }
+
+    // One pass over in for block [lo, hi). bias holds contributions already known for the
+    // block's variables (from the parent pass) and receives this pass's single-literal ones.
+    bool process_block(FILE* in, int lo, int hi, vector<double> bias, string& err) {
+        FILE* spill = open_temp_file(tmpDir);
+        if (!spill) { err = "failed to create a temporary spill file"; return false; }
+        ClauseFileWriter W(spill);
+        ClauseFileReader R(in);
+        passes++;
+        double w;
+        uint32_t tail, k;
+        const int* lits;
+        vector<int> blockLits;
+        while (R.next(w, tail, k, lits)) {
+            bool sat = false;
+            uint32_t after = tail;
+            blockLits.clear();
+            for (uint32_t j = 0; j < k; ++j) {
+                int v = abs(lits[j]);
+                if (v < lo) { if (lit_true(lits[j])) { sat = true; break; } }
+                else if (v >= hi) after++;
+                else blockLits.push_back(lits[j]);
+            }
+            if (sat || blockLits.empty()) continue;
+            if (blockLits.size() == 1) {
+                double x = ldexp(weight(w), -(int)min<uint32_t>(after, 2000));
+                bias[abs(blockLits[0]) - lo] += blockLits[0] > 0 ? x : -x;
+            } else {
+                W.put(w, after, blockLits.data(), (uint32_t)blockLits.size());
+            }
+        }
+        if (!W.flush()) { fclose(spill); err = "failed to write a spill file"; return false; }
+        spillBytes += W.bytes;
+
+        bool ok = true;
+        if (W.bytes <= memBudget || hi - lo == 1) {
+            vector<double> cw;
+            vector<uint32_t> ct;
+            vector<size_t> cs(1, 0);
+            vector<int> cl;
+            cw.reserve(W.count);
+            ClauseFileReader S(spill);
+            while (S.next(w, tail, k, lits)) {
+                cw.push_back(weight(w));
+                ct.push_back(tail);
+                cl.insert(cl.end(), lits, lits + k);
+                cs.push_back(cl.size());
+            }
+            decide_in_memory(lo, hi, bias, cw, ct, cs, cl);
+        } else {
+            // split so that each sub-block's share of the spill roughly fits the budget
+            uint64_t parts = min<uint64_t>(hi - lo, max<uint64_t>(2, W.bytes / max<size_t>(memBudget, 1) + 1));
+            int step = (int)((hi - lo + parts - 1) / parts);
+            for (int s = lo; s < hi && ok; s += step) {
+                int e = min(hi, s + step);
+                ok = process_block(spill, s, e, vector<double>(bias.begin() + (s - lo), bias.begin() + (e - lo)), err);
+            }
+        }
+        fclose(spill);
+        return ok;
+    }
+
+    double evaluate(FILE* in, double constSat) {
+        ClauseFileReader R(in);
+        passes++;
+        double total = constSat, w;
+        uint32_t tail, k;
+        const int* lits;
+        while (R.next(w, tail, k, lits))
+            for (uint32_t j = 0; j < k; ++j) if (lit_true(lits[j])) { total += weight(w); break; }
+        return total;
+    }
+};
+
+// Convert the instance at path into a binary clause file. Literals are deduplicated, empty
+// and zero-weight clauses dropped, tautologies added to constSat. RAM stays O(clause length).
+bool stream_convert(const char* path, FILE* out, InstanceInfo& info, double& constSat, uint64_t& kept, string& err) {
+    MappedFile F;
+    if (!F.open(path, err)) return false;
+    ClauseFileWriter W(out);
+    uint64_t hardTaut = 0;
+    struct FileSink {
+        ClauseFileWriter& W;
+        double& constSat;
+        uint64_t& hardTaut;
+        vector<int> L;
+        void begin(int, long long) {}
+        void clause(double w, bool hard, const int* lits, int k) {
+            if (hard) w = -1.0;
+            if (k == 0 || (!hard && w <= 0.0)) return;
+            L.assign(lits, lits + k);
+            sort(L.begin(), L.end(), [](int a, int b) { return abs(a) != abs(b) ? abs(a) < abs(b) : a < b; });
+            L.erase(unique(L.begin(), L.end()), L.end());
+            for (size_t i = 1; i < L.size(); ++i)
+                if (L[i] == -L[i-1]) { if (hard) hardTaut++; else constSat += w; return; }
+            W.put(w, 0, L.data(), (uint32_t)L.size());
+        }
+    } sink{W, constSat, hardTaut, {}};
+    constSat = 0.0;
+    if (!parse_instance(F.data, F.size, sink, info, err)) {
+        err = string(path) + ": " + err;
+        return false;
+    }
+    constSat += hardTaut * info.hard_weight;
+    kept = W.count;
+    if (!W.flush() || fflush(out) != 0) { err = "failed to write the clause file"; return false; }
+    return true;
+}
+
+// Streaming derand_half over the instance at path with passes top-level blocks.
+// Returns false on error; assign[1..n] receives the decisions.
+bool stream_derand_half(const char* path, int passes, size_t mem_budget, const string& tmp_dir,
+                        vector<int>& assign, double& value, InstanceInfo& info, uint64_t& total_passes,
+                        uint64_t& spill_bytes, string& err) {
+    FILE* cf = open_temp_file(tmp_dir);
+    if (!cf) { err = "failed to create the temporary clause file"; return false; }
+    double constSat = 0.0;
+    uint64_t kept = 0;
+    if (!stream_convert(path, cf, info, constSat, kept, err)) { fclose(cf); return false; }
+    StreamDerand S;
+    S.n = info.n;
+    S.hardWeight = info.hard_weight;
+    S.memBudget = mem_budget;
+    S.tmpDir = tmp_dir;
+    S.assign.assign(S.n + 1, -1);
+    int block = max(1, (S.n + max(1, passes) - 1) / max(1, passes));
+    bool ok = true;
+    for (int lo = 1; lo <= S.n && ok; lo += block) {
+        int hi = min(S.n + 1, lo + block);
+        ok = S.process_block(cf, lo, hi, vector<double>(hi - lo, 0.0), err);
+    }
+    if (ok) {
+        value = S.evaluate(cf, constSat);
+        assign.assign(S.n + 1, 0);
+        for (int v = 1; v <= S.n; ++v) assign[v] = S.assign[v] == 1 ? 1 : 0;
+        total_passes = S.passes + 1;   // + the conversion pass
+        spill_bytes = S.spillBytes;
+    }
+    fclose(cf);
+    return ok;
+}
+
+// ---------------------------------------------------------------------------------------
+// Batch mode (--batch=DIR|MANIFEST)
+//
+// Solves many instances in one process: jobs are dealt round-robin onto per-worker deques;
+// a worker pops from the back of its own deque and, when empty, steals from the front of
+// the others. Each worker parses into a monotonic arena that is reset between instances,
+// so clause storage costs no per-clause heap traffic. One JSON object per line per instance.
+// ---------------------------------------------------------------------------------------
+
+// Instance paths of a directory (regular files, sorted) or of a manifest (one path per
+// line, relative to the manifest's folder; blank lines and '#' comments skipped).
+bool batch_instances(const string& src, vector<string>& paths, string& err) {
+    namespace fs = std::filesystem;
+    std::error_code ec;
+    if (fs::is_directory(src, ec)) {
+        for (auto& e : fs::directory_iterator(src, ec))
+            if (e.is_regular_file(ec)) paths.push_back(e.path().string());
+        if (ec) { err = src + ": " + ec.message(); return false; }
+        sort(paths.begin(), paths.end());
+        return true;
+    }
+    ifstream in(src);
+    if (!in) { err = src + ": cannot open manifest"; return false; }
+    fs::path base = fs::path(src).parent_path();
+    string line;
+    while (getline(in, line)) {
+        size_t b = line.find_first_not_of(" \t\r"), e = line.find_last_not_of(" \t\r");
+        if (b == string::npos || line[b] == '#') continue;
+        fs::path p = line.substr(b, e - b + 1);
+        paths.push_back((p.is_relative() && !base.empty() ? base / p : p).string());
+    }
+    return true;
+}
+
+string json_escape(const string& s) {
+    string r;
+    for (unsigned char c : s) {
+        if (c == '"' || c == '\\') { r += '\\'; r += (char)c; }
+        else if (c < 0x20) { char b[8]; snprintf(b, sizeof b, "\\u%04x", c); r += b; }
+        else r += (char)c;
+    }
+    return r;
+}
+
+struct WorkStealingQueues {
+    struct alignas(64) Deque { mutex mu; deque<size_t> jobs; };
+    vector<Deque> q;
+
+    WorkStealingQueues(int workers, size_t jobs) : q(workers) {
+        for (size_t j = 0; j < jobs; ++j) q[j % workers].jobs.push_back(j);
+    }
+
+    bool next(int self, size_t& job) {
+        {
+            lock_guard<mutex> lk(q[self].mu);
+            if (!q[self].jobs.empty()) { job = q[self].jobs.back(); q[self].jobs.pop_back(); return true; }
+        }
+        int W = (int)q.size();
+        for (int d = 1; d < W; ++d) {
+            Deque& v = q[(self + d) % W];
+            lock_guard<mutex> lk(v.mu);
+            if (!v.jobs.empty()) { job = v.jobs.front(); v.jobs.pop_front(); return true; }
+        }
+        return false;   // no job is ever added, so empty everywhere means done
+    }
+};
+
+// Solve one instance with the fused derandomizations and return its JSON line.
+// E is the worker's evaluator, rebound to every instance.
+string batch_solve(const string& path, bool do_preprocess, pmr::memory_resource* arena, ExpectedWeightEvaluator& E) {
     using Clock = chrono::high_resolution_clock;
+    auto us = [](Clock::time_point a, Clock::time_point b) {
+        return (long long)chrono::duration_cast<chrono::microseconds>(b - a).count();
+    };
+    ostringstream js;
+    js << setprecision(15) << "{\"instance\":\"" << json_escape(path) << "\"";
+    auto t0 = Clock::now();
+    int n = 0;
+    vector<Clause> clauses;
+    InstanceInfo info;
+    string err;
+    if (!load_instance(path.c_str(), n, clauses, info, err, arena)) {
+        js << ",\"error\":\"" << json_escape(err) << "\"}";
+        return js.str();
+    }
     auto t1 = Clock::now();
-    auto assign_half = derand_half(n, clauses);
+    Preprocessed P = do_preprocess ? preprocess(n, clauses) : identity_instance(n, clauses);
     auto t2 = Clock::now();
-    double val_half = eval_assignment(assign_half, clauses);
+    double lp_value = 0.0;
+    auto x = solve_lp_relaxation(P.n, P.clauses, &lp_value);
     auto t3 = Clock::now();
+    ClauseBuckets B = bucket_clauses(P.n, P.clauses);
+    E.bind(B);
+    const FusedResult& F = derand_fused(E, x);
+    auto t4 = Clock::now();
+    js << ",\"format\":\"" << info.format << "\",\"n\":" << n << ",\"m\":" << info.m
+       << ",\"half\":" << eval_assignment(P.restore(F.half), clauses)
+       << ",\"lp_rounding\":" << eval_assignment(P.restore(F.lp), clauses)
+       << ",\"mixture\":" << eval_assignment(P.restore(F.mix), clauses)
+       << ",\"lp_bound\":" << lp_value + P.satWeight
+       << ",\"us\":{\"parse\":" << us(t0, t1) << ",\"preprocess\":" << us(t1, t2) << ",\"lp\":" << us(t2, t3)
+       << ",\"derandomize\":" << us(t3, t4) << "}}";
+    return js.str();
+}
+
+// Run the batch with threads workers (0 = hardware threads), JSON lines to out.
+bool run_batch(const string& src, int threads, bool do_preprocess, ostream& out, string& err) {
+    vector<string> paths;
+    if (!batch_instances(src, paths, err)) return false;
+    if (threads <= 0) threads = max(1u, thread::hardware_concurrency());
+    threads = (int)max<size_t>(1, min<size_t>(threads, paths.size()));
+    WorkStealingQueues Q(threads, paths.size());
+    mutex outMu;
+    auto worker = [&](int self) {
+        // the arena starts on a worker-owned slab, grown to the largest instance seen
+        vector<std::byte> slab(size_t(1) << 20);
+        ExpectedWeightEvaluator evaluator;
+        size_t job;
+        while (Q.next(self, job)) {
+            string line;
+            size_t used;
+            {
+                pmr::monotonic_buffer_resource arena(slab.data(), slab.size(), pmr::new_delete_resource());
+                struct Counting : pmr::memory_resource {
+                    pmr::memory_resource* up;
+                    size_t bytes = 0;
+                    void* do_allocate(size_t b, size_t a) override { bytes += b; return up->allocate(b, a); }
+                    void do_deallocate(void* p, size_t b, size_t a) override { up->deallocate(p, b, a); }
+                    bool do_is_equal(const pmr::memory_resource& o) const noexcept override { return this == &o; }
+                } counted;
+                counted.up = &arena;
+                line = batch_solve(paths[job], do_preprocess, &counted, evaluator);
+                used = counted.bytes;
+            }
+            if (used > slab.size()) slab = vector<std::byte>(used + used / 4);
+            lock_guard<mutex> lk(outMu);
+            out << line << '\n';
+        }
+    };
+    vector<thread> pool;
+    for (int t = 1; t < threads; ++t) pool.emplace_back(worker, t);
+    worker(0);
+    for (auto& th : pool) th.join();
+    out.flush();
+    return true;
+}
+
+// Set by SIGINT in anytime mode; the running stage winds down and the best result is printed
+atomic<bool> g_interrupt{false};
+
+extern "C" void on_sigint(int) { g_interrupt.store(true); }
+
+// maxsat_bench.cpp includes this file with MAXSAT_NO_MAIN defined to reuse the solvers
+#ifndef MAXSAT_NO_MAIN
+int main(int argc, char** argv) {
+    ios::sync_with_stdio(false);
+    cin.tie(nullptr);
+    auto t_program_start = chrono::steady_clock::now();
+
+    // command line: [instance] [--ls-ms=T] [--seed=S] [--no-preprocess]
+    //               [--stream [--stream-passes=P] [--stream-mem=MB] [--stream-dir=DIR]]
+    //               [--batch=DIR|MANIFEST [--threads=T]] [--deadline-ms=T] [--portfolio=N]
+    // instance defaults to input1.txt next to the executable; --ls-ms enables the
+    // local-search polishing phase with a budget of T milliseconds; --stream runs only the
+    // out-of-core derandomized 1/2 (P blocks of variables, MB of RAM for spilled clauses);
+    // --batch solves every instance of a directory or manifest, one JSON line each;
+    // --deadline-ms runs the anytime mode (stages by cost, best result when time is up);
+    // --portfolio draws N randomized roundings on --threads threads and keeps the best
+    const char *FNAME = "input1.txt";
+    double ls_ms = 0.0;
+    uint64_t seed = 1;
+    bool do_preprocess = true;
+    bool stream = false;
+    int stream_passes = 4;
+    size_t stream_mem = size_t(256) << 20;
+    string stream_dir;
+    string batch_src;
+    int threads = 0;
+    double deadline_ms = 0.0;
+    long long portfolio = 0;
+    for (int i = 1; i < argc; ++i) {
+        string a = argv[i];
+        if (a.rfind("--ls-ms=", 0) == 0) ls_ms = atof(a.c_str() + 8);
+        else if (a == "--no-preprocess") do_preprocess = false;
+        else if (a == "--stream") stream = true;
+        else if (a.rfind("--stream-passes=", 0) == 0) stream_passes = max(1, atoi(a.c_str() + 16));
+        else if (a.rfind("--stream-mem=", 0) == 0) stream_mem = size_t(max(1.0, atof(a.c_str() + 13)) * (1 << 20));
+        else if (a.rfind("--stream-dir=", 0) == 0) stream_dir = a.substr(13);
+        else if (a.rfind("--batch=", 0) == 0) batch_src = a.substr(8);
+        else if (a.rfind("--threads=", 0) == 0) threads = atoi(a.c_str() + 10);
+        else if (a.rfind("--deadline-ms=", 0) == 0) deadline_ms = atof(a.c_str() + 14);
+        else if (a.rfind("--portfolio=", 0) == 0) portfolio = max(0LL, atoll(a.c_str() + 12));
+        else if (a.rfind("--seed=", 0) == 0) seed = strtoull(a.c_str() + 7, nullptr, 10);
+        else if (a.rfind("--", 0) == 0) { cerr << "Unknown option: " << a << "\n"; return 1; }
+        else FNAME = argv[i];
+    }
+    using Clock = chrono::high_resolution_clock;
+    if (!batch_src.empty()) {
+        string err;
+        if (!run_batch(batch_src, threads, do_preprocess, cout, err)) {
+            cerr << err << "\n";
+            return 1;
+        }
+        return 0;
+    }
+    if (stream) {
+        auto ts = Clock::now();
+        InstanceInfo sinfo;
+        vector<int> assign;
+        double value = 0.0;
+        uint64_t passes = 0, spill = 0;
+        string err;
+        if (!stream_derand_half(FNAME, stream_passes, stream_mem, stream_dir, assign, value, sinfo, passes, spill, err)) {
+            cerr << err << "\n";
+            return 1;
+        }
+        auto te = Clock::now();
+        cerr << "Streamed " << FNAME << " (" << sinfo.format << "): n = " << sinfo.n << ", m = " << sinfo.m
+             << ", " << passes << " passes, " << spill << " bytes spilled\n";
+        cout.setf(std::ios::fixed); cout << setprecision(6);
+        cout << "Streaming derandomized 1/2 assignment (value = " << value << "):\n";
+        for (int i = 1; i <= sinfo.n; ++i) cout << assign[i] << (i==sinfo.n? '\n' : ' ');
+        if (sinfo.n == 0) cout << '\n';
+        cout << "\nTimings (microseconds):\n";
+        cout << "  streaming derandomization: " << chrono::duration_cast<chrono::microseconds>(te - ts).count() << "\n";
+        return 0;
+    }
+    auto t_parse_start = Clock::now();
+    int orig_n = 0;
+    vector<Clause> orig_clauses;
+    InstanceInfo info;
+    string err;
+    if (!load_instance(FNAME, orig_n, orig_clauses, info, err)) {
+        cerr << err << "\n";
+        return 1;
+    }
+    auto t_parse_end = Clock::now();
+    auto dur_parse_us = chrono::duration_cast<chrono::microseconds>(t_parse_end - t_parse_start).count();
+    cerr << "Loaded " << FNAME << " (" << info.format << "): n = " << orig_n << ", m = " << info.m;
+    if (info.hard > 0) cerr << ", " << info.hard << " hard clauses weighted " << info.hard_weight;
+    cerr << "\n";
+
+    // 0) preprocessing; every solver below works on the reduced instance and assignments
+    // are mapped back and scored on the original clauses
+    auto t_pre_start = Clock::now();
+    Preprocessed P = do_preprocess ? preprocess(orig_n, orig_clauses) : identity_instance(orig_n, orig_clauses);
+    auto t_pre_end = Clock::now();
+    auto dur_pre_us = chrono::duration_cast<chrono::microseconds>(t_pre_end - t_pre_start).count();
+    const int n = P.n;
+    const vector<Clause>& clauses = P.clauses;
+    if (do_preprocess)
+        cerr << "Preprocessed: n = " << n << ", m = " << clauses.size() << " (" << P.tautologies << " tautologies, "
+             << P.duplicates << " duplicates merged, " << P.fixedVars << " variables fixed, "
+             << P.subsumed << " clauses subsumed)\n";
+    ClauseBuckets orig_buckets = bucket_clauses(orig_n, orig_clauses);
+    // the reduced instance, bucketed once for the derandomizations and the portfolio
+    ClauseBuckets buckets = bucket_clauses(n, clauses);
+    ExpectedWeightEvaluator evaluator(buckets);
+    auto value_of = [&](const vector<int>& a) { return eval_assignment(P.restore(a), orig_buckets); };
+    auto print_assign = [&](const vector<int>& a) {
+        vector<int> full = P.restore(a);
+        for (int i = 1; i <= orig_n; ++i) cout << full[i] << (i==orig_n? '\n' : ' ');
+        if (orig_n == 0) cout << '\n';
+    };
+
+    // Anytime mode: stages in order of cost, each one only improving the incumbent, which is
+    // reported on stdout as "incumbent <ms since start> <stage> <value>" whenever it improves.
+    // The deadline (from program start) or Ctrl-C stops the current stage early.
+    if (deadline_ms > 0.0) {
+        StopCondition halt;
+        halt.deadline = t_program_start + chrono::duration_cast<chrono::steady_clock::duration>(
+                                              chrono::duration<double, milli>(deadline_ms));
+        halt.flag = &g_interrupt;
+        signal(SIGINT, on_sigint);
+        cout.setf(ios::fixed); cout << setprecision(6);
+        vector<int> best(n+1, 0);
+        double bestVal = -1.0;
+        string bestStage = "none";
+        auto offer = [&](const vector<int>& a, const char* stage) {
+            double v = value_of(a);
+            if (v <= bestVal) return;
+            best = a; bestVal = v; bestStage = stage;
+            double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - t_program_start).count();
+            cout << "incumbent " << setprecision(3) << ms << setprecision(6) << " " << stage << " " << v << endl;
+        };
+        auto remaining_ms = [&]() {
+            return max(0.0, chrono::duration<double, milli>(halt.deadline - chrono::steady_clock::now()).count());
+        };
+        // 1) derandomized 1/2: one sweep over the occurrence lists
+        offer(derand_fused(evaluator, {}).half, "half");
+        // 2) local search from it: --ls-ms if given, otherwise a quarter of the time left
+        if (!halt.stop()) {
+            double budget = min(remaining_ms(), ls_ms > 0.0 ? ls_ms : remaining_ms() / 4);
+            offer(local_search(n, clauses, best, budget, seed, 0.2, nullptr, &halt), "local_search");
+        }
+        // 3) LP relaxation (interruptible) and the LP-rounding / 3/4 mixture derandomizations;
+        // skipped when the dense tableau alone would not fit in memory or in the time left
+        // (building it cannot be interrupted; ~1e5 cells per ms)
+        // The LP is kept for the dive in 3c.
+        double lp_value = numeric_limits<double>::infinity();
+        vector<double> lp_x;
+        unique_ptr<IncrementalMaxSatLP> lp;
+        double lp_cells = double(2 * clauses.size() + n + 1) * double(n + clauses.size() + 1);
+        if (!halt.stop() && lp_cells * 16 <= double(1ULL << 30) && lp_cells / 1e5 <= remaining_ms()) {
+            lp = make_unique<IncrementalMaxSatLP>(n, clauses);
+            lp_value = lp->solve(&halt);
+            if (isfinite(lp_value)) {
+                lp_x = lp->probs();
+                const FusedResult& F = derand_fused(evaluator, lp_x);
+                offer(F.lp, "lp_rounding");
+                offer(F.mix, "mixture");
+            }
+        }
+        // 3b) rounding portfolio, from the LP probabilities when the LP was solved
+        if (portfolio > 0 && !halt.stop()) {
+            vector<double> x;
+            if (isfinite(lp_value)) x = lp_x;
+            PortfolioResult R = rounding_portfolio(buckets, x, portfolio, seed, threads, &halt);
+            if (R.sample >= 0) offer(R.assign, "portfolio");
+        }
+        // 3c) LP dive: variables the LP already sets to 0 or 1 are fixed there, then the
+        // fractional variable closest to 0 or 1 is rounded and the LP re-solved from its
+        // basis (dual simplex, usually a few pivots), until every variable is fixed
+        if (lp && isfinite(lp_value) && !halt.stop()) {
+            vector<int> a(n+1, -1);
+            vector<double> x = lp_x;
+            int fixed = 0;
+            while (fixed < n && !halt.stop()) {
+                int pick = 0;
+                double dist = 1.0;
+                for (int v = 1; v <= n; ++v) {
+                    if (a[v] >= 0) continue;
+                    double d = min(x[v], 1.0 - x[v]);
+                    if (d <= EPS) { a[v] = x[v] > 0.5; lp->fix_variable(v, a[v]); fixed++; }
+                    else if (d < dist) { dist = d; pick = v; }
+                }
+                if (pick == 0) continue;
+                a[pick] = x[pick] >= 0.5;
+                lp->fix_variable(pick, a[pick]);
+                fixed++;
+                if (!isfinite(lp->solve(&halt))) break;
+                x = lp->probs();
+            }
+            if (fixed == n) offer(a, "lp_dive");
+        }
+        lp.reset();
+        // an incumbent that meets the LP bound is optimal
+        bool proven = bestVal >= lp_value + P.satWeight - 1e-9 * max(1.0, fabs(bestVal));
+        // 4) branch and bound until the deadline
+        if (!proven && !halt.stop())
+            branch_and_bound_opt(n, clauses, best, lp_value, nullptr, &halt, &proven,
+                                 [&](const vector<int>& a) { offer(a, "branch_and_bound"); });
+        signal(SIGINT, SIG_DFL);
+        cout << "Best assignment (value = " << bestVal << ", stage = " << bestStage
+             << (proven ? ", optimal" : "") << (g_interrupt.load() ? ", interrupted" : "") << "):\n";
+        print_assign(best);
+        return 0;
+    }
 
-    // 2) LP relaxation and derandomized rounding (measure LP build+solve separately from rounding)
+    // 1) LP relaxation
     auto t_lp_start = Clock::now();
-    auto x_probs = solve_lp_relaxation(n, clauses);
+    double lp_value = 0.0;
+    auto x_probs = solve_lp_relaxation(n, clauses, &lp_value);
     auto t_lp_end = Clock::now();
 
-    auto t_rnd_start = Clock::now();
-    auto assign_lp = derand_lp_rounding(n, clauses, x_probs);
-    auto t_rnd_end = Clock::now();
-    double val_lp = eval_assignment(assign_lp, clauses);
+    // 2) derandomized 1/2, LP rounding and their 3/4 mixture in one fused sweep
+    auto t1 = Clock::now();
+    FusedResult fused = derand_fused(evaluator, x_probs);
+    auto t2 = Clock::now();
+    const vector<int>& assign_half = fused.half;
+    const vector<int>& assign_lp = fused.lp;
+    const vector<int>& assign_mix = fused.mix;
+    // the three are scored together, one lane each, by the bit-sliced evaluator
+    vector<double> fused_vals = eval_assignments(orig_buckets,
+                                                 {P.restore(assign_half), P.restore(assign_lp), P.restore(assign_mix)});
+    double val_half = fused_vals[0];
+    double val_lp = fused_vals[1];
+    double val_mix = fused_vals[2];
 
     cout.setf(ios::fixed); cout<<setprecision(6);
-    auto dur_derand_half_s = chrono::duration<double>(t2 - t1).count();
-    auto dur_eval_after_half_s = chrono::duration<double>(t3 - t2).count();
-    auto dur_lp_solve_s = chrono::duration<double>(t_lp_end - t_lp_start).count();
-    auto dur_derand_round_s = chrono::duration<double>(t_rnd_end - t_rnd_start).count();
-    auto dur_derand_half_us = chrono::duration_cast<chrono::microseconds>(t2 - t1).count();
-    auto dur_eval_after_half_us = chrono::duration_cast<chrono::microseconds>(t3 - t2).count();
     auto dur_lp_solve_us = chrono::duration_cast<chrono::microseconds>(t_lp_end - t_lp_start).count();
-    auto dur_derand_round_us = chrono::duration_cast<chrono::microseconds>(t_rnd_end - t_rnd_start).count();
+    auto dur_fused_us = chrono::duration_cast<chrono::microseconds>(t2 - t1).count();
 
     cout << "Derandomized 1/2 assignment (value = " << val_half << "):\n";
-    for (int i = 1; i <= n; ++i) cout << assign_half[i] << (i==n? '\n' : ' ');
+    print_assign(assign_half);
     cout << "Derandomized LP-rounding assignment (value = " << val_lp << "):\n";
-    for (int i = 1; i <= n; ++i) cout << assign_lp[i] << (i==n? '\n' : ' ');
+    print_assign(assign_lp);
+    cout << "Derandomized 3/4 mixture assignment (value = " << val_mix << "):\n";
+    print_assign(assign_mix);
+    double val_best = max({val_half, val_lp, val_mix});
+    cout << "Best of the three (value = " << val_best << ", at least 3/4 of the optimum)\n";
 
-    // print probabilities from LP for reference
+    // print probabilities from LP for reference (fixed variables show their value)
     cout << "LP variable probabilities:\n";
-    for (int i = 1; i <= n; ++i) cout << x_probs[i] << (i==n? '\n' : ' ');
+    vector<double> full_probs = P.restore_probs(x_probs);
+    for (int i = 1; i <= orig_n; ++i) cout << full_probs[i] << (i==orig_n? '\n' : ' ');
 
-    // Run brute-force (if n small) to get optimal for comparison
+    vector<int> incumbent = val_best == val_half ? assign_half : val_best == val_lp ? assign_lp : assign_mix;
+
+    // Optional portfolio of randomized roundings racing the derandomized assignments
+    long long dur_portfolio_us = -1;
+    if (portfolio > 0) {
+        auto t_pf_start = Clock::now();
+        PortfolioResult R = rounding_portfolio(buckets, x_probs, portfolio, seed, threads);
+        auto t_pf_end = Clock::now();
+        dur_portfolio_us = chrono::duration_cast<chrono::microseconds>(t_pf_end - t_pf_start).count();
+        double val_pf = value_of(R.assign);
+        cout << "Rounding portfolio assignment (value = " << val_pf << ", best of " << R.drawn
+             << " samples, sample " << R.sample << " from " << (R.sample & 1 ? "LP probabilities" : "p = 1/2") << "):\n";
+        print_assign(R.assign);
+        if (val_pf > val_best) { incumbent = R.assign; val_best = val_pf; }
+    }
+
+    // Optional local-search polish of the best assignment so far
+    long long dur_ls_us = -1;
+    if (ls_ms > 0.0) {
+        auto t_ls_start = Clock::now();
+        uint64_t flips = 0;
+        incumbent = local_search(n, clauses, incumbent, ls_ms, seed, 0.2, &flips);
+        auto t_ls_end = Clock::now();
+        dur_ls_us = chrono::duration_cast<chrono::microseconds>(t_ls_end - t_ls_start).count();
+        cout << "Local-search assignment (value = " << value_of(incumbent) << ", " << flips << " flips):\n";
+        print_assign(incumbent);
+    }
+
+    // Exact optimum by branch and bound, seeded with the best assignment so far
+    auto t_bnb_start = Clock::now();
+    uint64_t bnb_nodes = 0;
+    auto bnb = branch_and_bound_opt(n, clauses, incumbent, lp_value, &bnb_nodes);
+    auto t_bnb_end = Clock::now();
+    auto dur_bnb_us = chrono::duration_cast<chrono::microseconds>(t_bnb_end - t_bnb_start).count();
+    cout << "Branch-and-bound optimal value = " << value_of(bnb.second) << " (" << bnb_nodes << " nodes, LP bound = " << lp_value + P.satWeight << ")\n";
+    cout << "Branch-and-bound optimal assignment:\n";
+    print_assign(bnb.second);
+
+    // Run brute-force (if n small) to cross-check the optimum
     // measure brute-force time
+    const int BRUTE_MAX_N = 32;
     auto t_brute_start = Clock::now();
-    auto brute = brute_force_opt(n, clauses);
+    auto brute = n <= BRUTE_MAX_N ? brute_force_gray(n, clauses) : make_pair(-1.0, vector<int>());
     auto t_brute_end = Clock::now();
     auto dur_brute_s = chrono::duration<double>(t_brute_end - t_brute_start).count();
     auto dur_brute_us = chrono::duration_cast<chrono::microseconds>(t_brute_end - t_brute_start).count();
@@ -357,50 +2782,47 @@ int main() {
     if (brute.first < 0.0) {
         cout << "Brute-force exact solution skipped (n too large).\n";
     } else {
-        cout << "Brute-force optimal value = " << brute.first << "\n";
+        cout << "Brute-force optimal value = " << value_of(brute.second) << "\n";
         cout << "Brute-force optimal assignment:\n";
-        for (int i = 1; i <= n; ++i) cout << brute.second[i] << (i==n? '\n' : ' ');
+        print_assign(brute.second);
     }
     cout << "\nTimings:\n";
     // print seconds with higher precision, and microseconds as integer to avoid 0.000000 display
     cout << setprecision(9);
-    cout << "  derandomized 1/2 build time: "  << dur_derand_half_us << " us\n";
-    // cout << "  eval time after derandomized 1/2: " << dur_eval_after_half_s << " s (" << dur_eval_after_half_us << " us)\n";
+    cout << "  parse time: " << dur_parse_us << " us\n";
+    cout << "  preprocessing time: " << dur_pre_us << " us\n";
     cout << "  LP build+solve time: " <<  dur_lp_solve_us << " us\n";
-    cout << "  derandomized LP-rounding time: " << dur_derand_round_us << " us\n";
+    cout << "  fused derandomization time (1/2, LP rounding, 3/4 mixture): " << dur_fused_us << " us\n";
+    if (dur_portfolio_us >= 0) cout << "  rounding portfolio time: " << dur_portfolio_us << " us\n";
+    if (dur_ls_us >= 0) cout << "  local-search time: " << dur_ls_us << " us\n";
+    cout << "  branch-and-bound time: " << dur_bnb_us << " us\n";
     cout << "  brute-force time: " << dur_brute_us << " us\n";
     cout << setprecision(6);
 
 
     // If all measured microsecond counts are zero, offer a quick averaged micro-benchmark (cheap fallback)
-    if (dur_derand_half_us == 0 && dur_eval_after_half_us == 0 && dur_lp_solve_us == 0 && dur_derand_round_us == 0) {
+    if (dur_lp_solve_us == 0 && dur_fused_us == 0) {
         cout << "Measurements are all below 1 microsecond (too small to measure on this input).\n";
         cout << "Running a short averaged micro-benchmark (1000 repeats) to get measurable times...\n";
         const int REPEATS = 1000;
-        // measure derand_half repeated
-        auto tA1 = Clock::now();
-        for (int r=0;r<REPEATS;++r) { auto tmp = derand_half(n, clauses); (void)tmp; }
-        auto tA2 = Clock::now();
-        auto avg_derand_half_us = chrono::duration_cast<chrono::microseconds>(tA2 - tA1).count() / (double)REPEATS;
-
         // measure LP build+solve repeated
         auto tB1 = Clock::now();
         for (int r=0;r<REPEATS;++r) { auto tmp = solve_lp_relaxation(n, clauses); (void)tmp; }
         auto tB2 = Clock::now();
         auto avg_lp_us = chrono::duration_cast<chrono::microseconds>(tB2 - tB1).count() / (double)REPEATS;
 
-        // measure derand rounding repeated
+        // measure the fused derandomization repeated
         auto tC1 = Clock::now();
-        for (int r=0;r<REPEATS;++r) { auto tmp = derand_lp_rounding(n, clauses, x_probs); (void)tmp; }
+        for (int r=0;r<REPEATS;++r) { derand_fused(evaluator, x_probs); }
         auto tC2 = Clock::now();
-        auto avg_round_us = chrono::duration_cast<chrono::microseconds>(tC2 - tC1).count() / (double)REPEATS;
+        auto avg_fused_us = chrono::duration_cast<chrono::microseconds>(tC2 - tC1).count() / (double)REPEATS;
 
         cout << setprecision(6);
         cout << "Averaged micro-benchmark (per repeat):\n";
-        cout << "  derandomized 1/2 (avg): " << avg_derand_half_us << " us\n";
         cout << "  LP build+solve (avg):    " << avg_lp_us << " us\n";
-        cout << "  derand rounding (avg):  " << avg_round_us << " us\n";
+        cout << "  fused derandomization (avg): " << avg_fused_us << " us\n";
     }
 
     return 0;
 }
+#endif // MAXSAT_NO_MAIN
@@ -0,0 +1,358 @@
+// maxsat_bench.cpp
+// Benchmark suite for the solvers in maxsat_approx.cpp.
+//
+// Generates seeded weighted Max-SAT instances of three families:
+//   random      uniform random k-SAT, each clause on k distinct variables with random signs,
+//   planted     random k-SAT where every clause falsified by a hidden assignment gets one
+//               literal flipped, so the optimum is the total weight and ratios are exact,
+//   structured  industrial-like community attachment: variables are split into communities,
+//               most clauses draw all their variables from one community, and variable
+//               popularity inside a community is skewed (a few variables occur very often).
+// Weights are integers in 1..10. Each instance is written in the plain format to a temporary
+// file and then timed stage by stage over repeated trials: parse (load_instance and
+// bucket_clauses), derand_half, lp (solve_lp_relaxation), rounding (derand_lp_rounding) and
+// exact (branch_and_bound_opt with a time limit). The incremental LP is timed against cold
+// solves: lp_warm_add adds the last 1% of the clauses to an IncrementalMaxSatLP already
+// solved without them and re-solves from its basis (compare with lp), lp_warm_reweight then
+// changes the weights of 1% of the clauses and re-solves, and lp_cold_reweight solves that
+// reweighted instance from scratch with solve_lp_relaxation. One CSV line per instance and stage is printed
+// with mean and minimum time, throughput in clauses per second, the value found and its
+// ratio to the best known reference (planted optimum, proven optimum or LP bound). The two
+// reweight stages solve a different instance and are compared with its own reference: the
+// reweighted total for planted instances, otherwise the LP bound of the cold solve.
+//
+// Compile: g++ -O2 -std=c++17 -pthread maxsat_bench.cpp -o maxsat_bench.exe
+// Usage:   maxsat_bench [--family=random,planted,structured] [--n=100,1000] [--m=...]
+//                       [--ratio=4.2] [--k=3] [--seed=1] [--trials=5] [--exact-ms=1000]
+//                       [--lp-cells=500000]
+// Lists are comma separated and every combination is run. Without --m, m = ratio * n.
+// The LP stages are skipped when the dense simplex tableau would exceed --lp-cells entries.
+
+#define MAXSAT_NO_MAIN
+#include "maxsat_approx.cpp"
+#undef MAXSAT_NO_MAIN
+
+// ---------------------------------------------------------------------------------------
+// Instance generators
+// ---------------------------------------------------------------------------------------
+
+// k distinct variables from 1..n, drawn by pick()
+template <class Pick>
+void distinct_vars(int k, Pick&& pick, vector<int>& vars) {
+    vars.clear();
+    while ((int)vars.size() < k) {
+        int v = pick();
+        if (find(vars.begin(), vars.end(), v) == vars.end()) vars.push_back(v);
+    }
+}
+
+vector<Clause> gen_random(int n, long long m, int k, mt19937_64& rng) {
+    vector<Clause> clauses;
+    clauses.reserve((size_t)m);
+    uniform_int_distribution<int> var(1, n), weight(1, 10);
+    vector<int> vars;
+    for (long long i = 0; i < m; ++i) {
+        distinct_vars(k, [&]() { return var(rng); }, vars);
+        Clause C;
+        C.w = weight(rng);
+        for (int v : vars) C.lits.push_back({v, (rng() & 1) ? 1 : -1});
+        clauses.push_back(move(C));
+    }
+    return clauses;
+}
+
+// Clauses that the hidden assignment falsifies get one literal flipped to agree with it,
+// which keeps the literal distribution close to uniform.
+vector<Clause> gen_planted(int n, long long m, int k, mt19937_64& rng) {
+    vector<int> hidden(n+1);
+    for (int v = 1; v <= n; ++v) hidden[v] = (int)(rng() & 1);
+    vector<Clause> clauses = gen_random(n, m, k, rng);
+    for (auto& C : clauses) {
+        bool sat = false;
+        for (auto& lit : C.lits) sat |= (lit.second == 1) == (hidden[lit.first] == 1);
+        if (!sat) {
+            auto& lit = C.lits[rng() % C.lits.size()];
+            lit.second = -lit.second;
+        }
+    }
+    return clauses;
+}
+
+// Community attachment: about sqrt(n) communities; a clause stays inside one community with
+// probability 0.9, otherwise every literal picks its own community. Inside a community the
+// variable is drawn with probability proportional to 1/rank (Zipf-like popularity).
+vector<Clause> gen_structured(int n, long long m, int k, mt19937_64& rng) {
+    int groups = max(1, (int)sqrt((double)n));
+    while (groups > 1 && n / groups < k) groups--;
+    int size = n / groups;                      // the last community also takes the remainder
+    int last = n - (groups - 1) * size;
+    vector<double> cdf(last);
+    double acc = 0;
+    for (int r = 0; r < last; ++r) cdf[r] = acc += 1.0 / (r + 1);
+    uniform_real_distribution<double> unit(0.0, 1.0);
+    uniform_int_distribution<int> group(0, groups - 1), weight(1, 10);
+    auto member = [&](int g) {
+        int gsize = g == groups - 1 ? last : size;
+        int r = (int)(lower_bound(cdf.begin(), cdf.begin() + gsize, unit(rng) * cdf[gsize-1]) - cdf.begin());
+        return g * size + min(r, gsize - 1) + 1;
+    };
+    vector<Clause> clauses;
+    clauses.reserve((size_t)m);
+    vector<int> vars;
+    for (long long i = 0; i < m; ++i) {
+        if (unit(rng) < 0.9) {
+            int g = group(rng);
+            distinct_vars(k, [&]() { return member(g); }, vars);
+        } else {
+            distinct_vars(k, [&]() { return member(group(rng)); }, vars);
+        }
+        Clause C;
+        C.w = weight(rng);
+        for (int v : vars) C.lits.push_back({v, (rng() & 1) ? 1 : -1});
+        clauses.push_back(move(C));
+    }
+    return clauses;
+}
+
+bool write_plain(const string& path, int n, const vector<Clause>& clauses) {
+    FILE* f = fopen(path.c_str(), "w");
+    if (!f) return false;
+    fprintf(f, "%d %zu\n", n, clauses.size());
+    for (auto& C : clauses) {
+        fprintf(f, "%.17g %zu", C.w, C.lits.size());
+        for (auto& lit : C.lits) fprintf(f, " %d", lit.first * lit.second);
+        fputc('\n', f);
+    }
+    return fclose(f) == 0;
+}
+
+// ---------------------------------------------------------------------------------------
+// Benchmark driver
+// ---------------------------------------------------------------------------------------
+
+struct StageStats {
+    vector<double> us;
+    double value = numeric_limits<double>::quiet_NaN();
+    void add(double t) { us.push_back(t); }
+    double mean() const { return us.empty() ? 0 : accumulate(us.begin(), us.end(), 0.0) / us.size(); }
+    double best() const { return us.empty() ? 0 : *min_element(us.begin(), us.end()); }
+};
+
+template <class T>
+vector<T> parse_list(const string& s) {
+    vector<T> out;
+    stringstream ss(s);
+    string item;
+    while (getline(ss, item, ',')) {
+        if (item.empty()) continue;
+        stringstream is(item);
+        T v;
+        if (is >> v) out.push_back(v);
+    }
+    return out;
+}
+
+double elapsed_us(chrono::steady_clock::time_point a, chrono::steady_clock::time_point b) {
+    return chrono::duration<double, micro>(b - a).count();
+}
+
+int main(int argc, char** argv) {
+    vector<string> families = {"random", "planted", "structured"};
+    vector<int> ns = {100, 1000};
+    vector<long long> ms;
+    vector<int> ks = {3};
+    double ratio = 4.2;
+    uint64_t seed = 1;
+    int trials = 5;
+    double exact_ms = 1000;
+    double lp_max_cells = 5e5;
+    for (int i = 1; i < argc; ++i) {
+        string a = argv[i];
+        auto val = [&](const char* opt) { return a.substr(strlen(opt)); };
+        if (a.rfind("--family=", 0) == 0) families = parse_list<string>(val("--family="));
+        else if (a.rfind("--n=", 0) == 0) ns = parse_list<int>(val("--n="));
+        else if (a.rfind("--m=", 0) == 0) ms = parse_list<long long>(val("--m="));
+        else if (a.rfind("--k=", 0) == 0) ks = parse_list<int>(val("--k="));
+        else if (a.rfind("--ratio=", 0) == 0) ratio = atof(val("--ratio=").c_str());
+        else if (a.rfind("--seed=", 0) == 0) seed = strtoull(val("--seed=").c_str(), nullptr, 10);
+        else if (a.rfind("--trials=", 0) == 0) trials = max(1, atoi(val("--trials=").c_str()));
+        else if (a.rfind("--exact-ms=", 0) == 0) exact_ms = atof(val("--exact-ms=").c_str());
+        else if (a.rfind("--lp-cells=", 0) == 0) lp_max_cells = atof(val("--lp-cells=").c_str());
+        else {
+            cerr << "Usage: " << argv[0] << " [--family=random,planted,structured] [--n=N,...] [--m=M,...]"
+                 << " [--ratio=R] [--k=K,...] [--seed=S] [--trials=T] [--exact-ms=T] [--lp-cells=C]" << endl;
+            return 1;
+        }
+    }
+    for (auto& f : families) {
+        if (f != "random" && f != "planted" && f != "structured") {
+            cerr << "Unknown family: " << f << endl;
+            return 1;
+        }
+    }
+
+    string tmp_dir = "/tmp";
+    if (const char* t = getenv("TMPDIR")) tmp_dir = t;
+
+    cout << "family,n,m,k,seed,stage,trials,mean_us,min_us,clauses_per_s,value,ratio,reference" << endl;
+    cout << setprecision(6);
+    for (auto& family : families) for (int n : ns) for (int k : ks) {
+        vector<long long> mlist = ms;
+        if (mlist.empty()) mlist.push_back(max(1LL, llround(ratio * n)));
+        for (long long m : mlist) {
+            if (k < 1 || k > n) {
+                cerr << "Skipping " << family << " n=" << n << " k=" << k << ": need 1 <= k <= n" << endl;
+                continue;
+            }
+            mt19937_64 rng(seed ^ (hash<string>()(family) + 0x9e3779b97f4a7c15ULL * (uint64_t)n + (uint64_t)m * 31 + k));
+            vector<Clause> gen = family == "random" ? gen_random(n, m, k, rng)
+                               : family == "planted" ? gen_planted(n, m, k, rng)
+                               : gen_structured(n, m, k, rng);
+            string path = tmp_dir + "/maxsat_bench_" + to_string(getpid()) + ".txt";
+            if (!write_plain(path, n, gen)) {
+                cerr << "Cannot write " << path << endl;
+                return 1;
+            }
+            double total = 0;
+            for (auto& C : gen) total += C.w;
+            // clauses re-weighted by the warm-start stages, the same in every trial
+            long long delta = max(1LL, m / 100);
+            vector<pair<int, double>> reweights;
+            for (long long j = 0; j < delta; ++j)
+                reweights.push_back({(int)(rng() % (uint64_t)m), (double)(1 + rng() % 10)});
+            double total_reweighted = total;
+            {
+                vector<double> w(gen.size());
+                for (size_t j = 0; j < gen.size(); ++j) w[j] = gen[j].w;
+                for (auto& rw : reweights) w[rw.first] = rw.second;
+                total_reweighted = accumulate(w.begin(), w.end(), 0.0);
+            }
+
+            map<string, StageStats> st;
+            int nn = 0;
+            vector<Clause> clauses;
+            ClauseBuckets buckets;
+            ExpectedWeightEvaluator evaluator;
+            vector<int> a_half, a_lp;
+            vector<double> probs;
+            double lp_bound = numeric_limits<double>::infinity();
+            double warm_add = lp_bound, warm_reweight = lp_bound, cold_reweight = lp_bound;
+            // dense tableau of (2m+n+1) x (n+m+1) entries; every pivot touches all of them
+            double lp_cells = (2.0 * m + n + 1) * (n + m + 1.0);
+            bool run_lp = lp_cells <= lp_max_cells;
+            if (!run_lp) cerr << family << " n=" << n << " m=" << m << ": LP tableau too large, skipping the LP stages" << endl;
+            for (int t = 0; t < trials; ++t) {
+                InstanceInfo info;
+                string err;
+                clauses.clear();
+                auto t0 = chrono::steady_clock::now();
+                if (!load_instance(path.c_str(), nn, clauses, info, err)) {
+                    cerr << "Parse failed: " << err << endl;
+                    remove(path.c_str());
+                    return 1;
+                }
+                buckets = bucket_clauses(nn, clauses);
+                evaluator.bind(buckets);
+                auto t1 = chrono::steady_clock::now();
+                st["parse"].add(elapsed_us(t0, t1));
+
+                t0 = chrono::steady_clock::now();
+                a_half = derand_half(evaluator);
+                t1 = chrono::steady_clock::now();
+                st["derand_half"].add(elapsed_us(t0, t1));
+
+                if (run_lp) {
+                    t0 = chrono::steady_clock::now();
+                    probs = solve_lp_relaxation(nn, clauses, &lp_bound);
+                    t1 = chrono::steady_clock::now();
+                    st["lp"].add(elapsed_us(t0, t1));
+
+                    t0 = chrono::steady_clock::now();
+                    a_lp = derand_lp_rounding(evaluator, probs);
+                    t1 = chrono::steady_clock::now();
+                    st["rounding"].add(elapsed_us(t0, t1));
+
+                    // building and first solving the incremental LP is not timed
+                    size_t kept = clauses.size() - min<size_t>(delta, clauses.size());
+                    IncrementalMaxSatLP inc(nn, vector<Clause>(clauses.begin(), clauses.begin() + kept));
+                    inc.reserve((int)(clauses.size() - kept));
+                    inc.solve();
+                    t0 = chrono::steady_clock::now();
+                    for (size_t ci = kept; ci < clauses.size(); ++ci) inc.add_clause(clauses[ci]);
+                    warm_add = inc.solve();
+                    t1 = chrono::steady_clock::now();
+                    st["lp_warm_add"].add(elapsed_us(t0, t1));
+
+                    vector<Clause> reweighted = clauses;
+                    for (auto& rw : reweights) reweighted[rw.first].w = rw.second;
+                    t0 = chrono::steady_clock::now();
+                    for (auto& rw : reweights) inc.set_weight(rw.first, rw.second);
+                    warm_reweight = inc.solve();
+                    t1 = chrono::steady_clock::now();
+                    st["lp_warm_reweight"].add(elapsed_us(t0, t1));
+
+                    t0 = chrono::steady_clock::now();
+                    solve_lp_relaxation(nn, reweighted, &cold_reweight);
+                    t1 = chrono::steady_clock::now();
+                    st["lp_cold_reweight"].add(elapsed_us(t0, t1));
+                }
+            }
+            remove(path.c_str());
+            st["derand_half"].value = eval_assignment(a_half, clauses);
+            if (run_lp) {
+                st["lp"].value = lp_bound;
+                st["rounding"].value = eval_assignment(a_lp, clauses);
+                st["lp_warm_add"].value = warm_add;
+                st["lp_warm_reweight"].value = warm_reweight;
+                st["lp_cold_reweight"].value = cold_reweight;
+                auto differs = [](double a, double b) { return fabs(a - b) > 1e-6 * max(1.0, fabs(b)); };
+                if (differs(warm_add, lp_bound) || differs(warm_reweight, cold_reweight))
+                    cerr << family << " n=" << n << " m=" << m << ": warm-started LP disagrees with the cold solve ("
+                         << warm_add << " vs " << lp_bound << ", " << warm_reweight << " vs " << cold_reweight << ")" << endl;
+            }
+
+            // exact: one run, bounded by exact_ms, seeded with the better approximation
+            bool proven = false;
+            if (exact_ms > 0) {
+                vector<int> inc = a_half;
+                if (run_lp && st["rounding"].value > st["derand_half"].value) inc = a_lp;
+                StopCondition halt;
+                auto t0 = chrono::steady_clock::now();
+                halt.deadline = t0 + chrono::microseconds((long long)(exact_ms * 1000));
+                auto res = branch_and_bound_opt(nn, clauses, inc, lp_bound, nullptr, &halt, &proven);
+                auto t1 = chrono::steady_clock::now();
+                st["exact"].add(elapsed_us(t0, t1));
+                st["exact"].value = res.first;
+            }
+
+            // reference for the ratios: planted instances are fully satisfiable, otherwise the
+            // proven optimum or, failing that, the LP bound (ratios are then lower bounds)
+            double ref = numeric_limits<double>::quiet_NaN();
+            string ref_name = "none";
+            if (family == "planted") { ref = total; ref_name = "planted"; }
+            else if (proven) { ref = st["exact"].value; ref_name = "optimum"; }
+            else if (isfinite(lp_bound)) { ref = lp_bound; ref_name = "lp_bound"; }
+            // the reweight stages solve the reweighted instance
+            double ref_rw = family == "planted" ? total_reweighted : cold_reweight;
+            string ref_rw_name = family == "planted" ? "planted_reweighted" : "lp_bound_reweighted";
+
+            for (const char* stage : {"parse", "derand_half", "lp", "rounding", "lp_warm_add", "lp_warm_reweight",
+                                      "lp_cold_reweight", "exact"}) {
+                auto it = st.find(stage);
+                if (it == st.end() || it->second.us.empty()) continue;
+                const StageStats& s = it->second;
+                double mean = s.mean();
+                bool reweighted = string(stage) == "lp_warm_reweight" || string(stage) == "lp_cold_reweight";
+                double r = reweighted ? ref_rw : ref;
+                cout << family << ',' << n << ',' << m << ',' << k << ',' << seed << ','
+                     << stage << ',' << s.us.size() << ',' << mean << ',' << s.best() << ','
+                     << (mean > 0 ? m / (mean * 1e-6) : 0.0) << ',';
+                if (!isnan(s.value)) cout << s.value;
+                cout << ',';
+                if (!isnan(s.value) && isfinite(r) && r > 0) cout << s.value / r;
+                cout << ',' << (proven && string(stage) == "exact" ? "optimum" : reweighted ? ref_rw_name : ref_name) << endl;
+            }
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,146 @@
+#include <iostream>
+#include <vector>
+#include <random>
+#include <queue>
+#include <sstream>
+#include <climits>
+using namespace std;
+
+#include "steiner_graph.cpp"       // SteinerGraph
+#include "steiner_metric.cpp"      // compute_metric_closure
+#include "steiner_tree_approx.cpp" // SteinerTreeApprox::query
+
+// Regression check for the metric closure on graphs with zero-weight edges and more than one
+// Floyd-Warshall tile (n > 64), where parent matrices used to contain cycles. For random graphs
+// it compares every distance with Dijkstra, walks every parent chain (it must reach the source
+// in fewer than n steps over edges of the graph and add up to the distance) and answers a few
+// queries with the 2-approximation, whose path reconstruction follows those chains. A path of
+// two 600000000 edges checks that lengths above INT_MAX / 2 are not taken for "no path".
+// Prints OK or the first mismatch; the exit code is 0 on success.
+
+vector<int> dijkstra(const SteinerGraph& g, int s) {
+    vector<int> d(g.num_vertices(), INT_MAX);
+    priority_queue<pair<int, int>, vector<pair<int, int>>, greater<pair<int, int>>> pq;
+    d[s] = 0;
+    pq.push(make_pair(0, s));
+    while(!pq.empty()) {
+        pair<int, int> top = pq.top();
+        pq.pop();
+        int u = top.second;
+        if(top.first > d[u]) continue;
+        for(int k = g.begin(u); k < g.end(u); k++) {
+            int v = g.neighbor(k);
+            if(d[u] + g.weight(k) < d[v]) {
+                d[v] = d[u] + g.weight(k);
+                pq.push(make_pair(d[v], v));
+            }
+        }
+    }
+    return d;
+}
+
+// Empty if dist and parent agree with g, otherwise a description of the first problem
+string check_closure(const SteinerGraph& g, const Matrix& dist, const Matrix& parent) {
+    int n = g.num_vertices();
+    for(int s = 0; s < n; s++) {
+        vector<int> d = dijkstra(g, s);
+        for(int v = 0; v < n; v++) {
+            string where = " at " + to_string(s) + "-" + to_string(v);
+            if(dist[s][v] != d[v]) return "distance" + where;
+            if(d[v] == INT_MAX) {
+                if(parent[s][v] != -1) return "parent of an unreachable vertex" + where;
+                continue;
+            }
+            int x = v, len = 0, steps = 0;
+            while(x != s) {
+                int p = parent[s][x];
+                if(p < 0 || g.find_edge(p, x) < 0) return "parent is not a neighbor" + where;
+                len += g.edge_weight(p, x);
+                x = p;
+                if(++steps >= n) return "parent cycle" + where;
+            }
+            if(parent[s][s] != s) return "parent of the source" + where;
+            if(len != d[v]) return "parent path length" + where;
+        }
+    }
+    return "";
+}
+
+// 0 - 1 - 2 with two heavy edges; the 0-2 distance is 1200000000
+bool check_long_path() {
+    SteinerGraph g(3);
+    g.add_edge(0, 1, 600000000);
+    g.add_edge(1, 2, 600000000);
+    g.finalize();
+    Matrix dist, parent;
+    compute_metric_closure(g, dist, &parent, 1);
+    string err = check_closure(g, dist, parent);
+    if(err.empty() && dist[0][2] != 1200000000) err = "distance 0-2 is " + to_string(dist[0][2]);
+    if(err.empty()) {
+        streambuf* out = cout.rdbuf();
+        ostringstream sink;
+        cout.rdbuf(sink.rdbuf());
+        SteinerTreeApprox approx(g);
+        approx.set_verbose(false);
+        approx.prepare();
+        cout.rdbuf(out);
+        SteinerQueryResult r = approx.query({0, 2});
+        if(r.metricCost != 1200000000 || r.treeCost != 1200000000)
+            err = "query cost " + to_string(r.metricCost) + " / " + to_string(r.treeCost);
+    }
+    if(!err.empty()) cout << "FAILED long path: " << err << endl;
+    return err.empty();
+}
+
+int main() {
+    mt19937 rng(43);
+    int graphs = 0;
+    if(!check_long_path()) return 1;
+    for(int n : {65, 100, 130, 200}) {
+        for(int zeroPercent : {20, 50, 90}) {
+            for(int rep = 0; rep < 3; rep++) {
+                // a sparse random graph; a share of the edges weighs 0, the rest 1..5
+                SteinerGraph g(n);
+                int m = n * (2 + rep);
+                for(int e = 0; e < m; e++) {
+                    int u = rng() % n, v = rng() % n;
+                    int w = (int)(rng() % 100) < zeroPercent ? 0 : 1 + rng() % 5;
+                    g.add_edge(u, v, w);
+                }
+                g.finalize();
+
+                for(int threads : {1, 3}) {
+                    Matrix dist, parent;
+                    compute_metric_closure(g, dist, &parent, threads);
+                    string err = check_closure(g, dist, parent);
+                    if(!err.empty()) {
+                        cout << "FAILED n=" << n << " zero=" << zeroPercent << "% rep=" << rep
+                             << " threads=" << threads << ": " << err << endl;
+                        return 1;
+                    }
+                }
+
+                streambuf* out = cout.rdbuf();
+                ostringstream sink;
+                cout.rdbuf(sink.rdbuf());
+                SteinerTreeApprox approx(g);
+                approx.set_verbose(false);
+                approx.prepare();
+                cout.rdbuf(out);
+                for(int q = 0; q < 10; q++) {
+                    vector<int> term;
+                    for(int t = 2 + rng() % 8; t > 0; t--) term.push_back(rng() % n);
+                    SteinerQueryResult r = approx.query(term);
+                    if(r.metricCost != INT_MAX && r.treeCost > r.metricCost) {
+                        cout << "FAILED n=" << n << " zero=" << zeroPercent << "% rep=" << rep
+                             << ": query tree cost " << r.treeCost << " above its MST cost " << r.metricCost << endl;
+                        return 1;
+                    }
+                }
+                graphs++;
+            }
+        }
+    }
+    cout << "OK (" << graphs << " graphs)" << endl;
+    return 0;
+}
@@ -2,88 +2,241 @@
 #include <vector>
 #include <iomanip>
 #include <tuple>
+#include <string>
+#include <sstream>
 using namespace std;
 
+#include "steiner_graph.cpp"      // Contains SteinerGraph (CSR graph shared by all solvers)
 #include "steiner_brute.cpp"      // Contains SteinerTreeBruteForce class
-#include "steiner_tree_approx.cpp" // Contains SteinerTreeApprox class
+#include "steiner_mehlhorn.cpp"    // Contains SteinerTreeMehlhorn class
+#include "steiner_dreyfus_wagner.cpp" // Contains SteinerTreeDreyfusWagner class
+#include "steiner_io.cpp"         // .stp / edge list / binary graph loaders
+#include "steiner_server.cpp"     // SteinerQueryServer (--serve), includes steiner_tree_approx.cpp (SteinerTreeApprox class)
+
+void print_usage(const char* prog) {
+    cout << "Usage: " << prog << " [graph file] [--algos=brute,approx,mehlhorn,dw] [--write-bin=out.bin] [--metric-cache=dir]" << endl;
+    cout << "       " << prog << " graph file --serve[=socket path] [--workers=N] [--metric-cache=dir]" << endl;
+    cout << "  graph file   SteinLib .stp, binary edge list (.bin) or plain edge list \"n m / u v w ... / k / t ...\"" << endl;
+    cout << "               without a file the graph and terminals are read interactively" << endl;
+    cout << "  --algos      algorithms to run (default: all)" << endl;
+    cout << "  --write-bin  save the loaded graph and terminals in the binary format" << endl;
+    cout << "  --metric-cache  reuse metric closures stored in dir (written there on the first run)" << endl;
+    cout << "  --serve      preprocess the graph once, then answer one terminal set per line from stdin" << endl;
+    cout << "               (or from clients of the Unix socket) with the 2-approximation" << endl;
+    cout << "  --workers    query threads for --serve (default: all cores)" << endl;
+}
+
+// Weight of a returned tree in the original graph, so every row of the table reports the same
+// quantity: getMinCost() is the metric MST cost for brute force and the 2-approximation but the
+// pruned tree cost for Mehlhorn. INT_MAX (terminals not connected) is passed through.
+int tree_cost(const SteinerGraph& g, const vector<pair<int,int>>& edges, int minCost) {
+    if(minCost == INT_MAX) return INT_MAX;
+    int cost = 0;
+    for(auto& e : edges) cost += g.edge_weight(e.first, e.second);
+    return cost;
+}
+
+int main(int argc, char** argv) {
+    string inputPath, binaryOut, metricCache, socketPath;
+    bool serve = false;
+    int workers = 0;
+    bool runBrute = true, runApprox = true, runMehlhorn = true, runDW = true;
+    for(int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if(arg == "-h" || arg == "--help") {
+            print_usage(argv[0]);
+            return 0;
+        } else if(arg.compare(0, 8, "--algos=") == 0) {
+            runBrute = runApprox = runMehlhorn = runDW = false;
+            stringstream list(arg.substr(8));
+            string name;
+            while(getline(list, name, ',')) {
+                if(name == "brute") runBrute = true;
+                else if(name == "approx") runApprox = true;
+                else if(name == "mehlhorn") runMehlhorn = true;
+                else if(name == "dw") runDW = true;
+                else {
+                    cout << "Unknown algorithm: " << name << endl;
+                    print_usage(argv[0]);
+                    return 1;
+                }
+            }
+        } else if(arg.compare(0, 12, "--write-bin=") == 0) {
+            binaryOut = arg.substr(12);
+        } else if(arg.compare(0, 15, "--metric-cache=") == 0) {
+            metricCache = arg.substr(15);
+        } else if(arg == "--serve") {
+            serve = true;
+        } else if(arg.compare(0, 8, "--serve=") == 0) {
+            serve = true;
+            socketPath = arg.substr(8);
+        } else if(arg.compare(0, 10, "--workers=") == 0) {
+            workers = atoi(arg.c_str() + 10);
+        } else if(arg[0] != '-' && inputPath.empty()) {
+            inputPath = arg;
+        } else {
+            cout << "Unknown option: " << arg << endl;
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if(serve) {
+        if(inputPath.empty()) {
+            cout << "--serve needs a graph file" << endl;
+            return 1;
+        }
+        // stdout carries the answers, so everything else goes to stderr
+        streambuf* out = cout.rdbuf(cerr.rdbuf());
+        SteinerInstance inst;
+        if(!load_instance(inputPath, inst)) return 1;
+        cout << "Loaded " << inputPath << ": " << inst.graph.num_vertices() << " vertices, "
+             << inst.graph.num_edges() << " edges" << endl;
+        SteinerTreeApprox approx(inst.graph);
+        approx.set_verbose(false);
+        approx.set_metric_cache(metricCache);
+        approx.prepare();
+        cout.rdbuf(out);
+        
+        SteinerQueryServer server(approx, inst.graph.num_vertices(), workers);
+        if(socketPath.empty()) server.serve_stdio();
+        else if(!server.serve_socket(socketPath)) return 1;
+        return 0;
+    }
 
-int main() {
     cout << "  STEINER TREE ALGORITHM COMPARISON TOOL" << endl;
-    int n, m;
-    cout << "\nEnter number of vertices: ";
-    cin >> n;
-    
-    cout << "Enter number of edges: ";
-    cin >> m;
     
-    cout << "\nEnter edges in format: u v weight" << endl;
-    
-    // Store edges to be used by both algorithms
-    vector<tuple<int, int, int>> edges;
+    // Store edges once in CSR form, shared by all algorithms
+    SteinerGraph graph;
+    vector<int> terminals;
     
-    for(int i = 0; i < m; i++) {
-        int u, v, w;
-        cout << "Edge " << (i+1) << ": ";
-        cin >> u >> v >> w;
-        edges.push_back({u, v, w});
-        cout << "Edge added: " << u << " - " << v << " (weight: " << w << ")" << endl;
+    if(!inputPath.empty()) {
+        SteinerInstance inst;
+        if(!load_instance(inputPath, inst)) return 1;
+        graph = inst.graph;
+        terminals = inst.terminals;
+        cout << "\nLoaded " << inputPath << ": " << graph.num_vertices() << " vertices, "
+             << graph.num_edges() << " edges, " << terminals.size() << " terminals" << endl;
+    } else {
+        int n, m;
+        cout << "\nEnter number of vertices: ";
+        cin >> n;
+    
+        cout << "Enter number of edges: ";
+        cin >> m;
+    
+        cout << "\nEnter edges in format: u v weight" << endl;
+    
+        graph = SteinerGraph(n);
+    
+        for(int i = 0; i < m; i++) {
+            int u, v, w;
+            cout << "Edge " << (i+1) << ": ";
+            cin >> u >> v >> w;
+            graph.add_edge(u, v, w);
+            cout << "Edge added: " << u << " - " << v << " (weight: " << w << ")" << endl;
+        }
+    
+        // Get terminal vertices
+        int numTerminals;
+        cout << "\nEnter number of terminal vertices: ";
+        cin >> numTerminals;
+    
+        cout << "Enter terminal vertices: ";
+        for(int i = 0; i < numTerminals; i++) {
+            int t;
+            cin >> t;
+            terminals.push_back(t);
+        }
     }
     
-    // Get terminal vertices
-    int numTerminals;
-    cout << "\nEnter number of terminal vertices: ";
-    cin >> numTerminals;
-    
-    vector<int> terminals;
-    cout << "Enter terminal vertices: ";
-    for(int i = 0; i < numTerminals; i++) {
-        int t;
-        cin >> t;
-        terminals.push_back(t);
+    graph.finalize();
+    if(!total_weight_fits(graph)) {
+        cout << "Edge weights add up to INT_MAX or more; path lengths would not fit in an int" << endl;
+        return 1;
     }
     
-    
-    SteinerTreeBruteForce bruteForce(n);
-    
-    for(auto& e : edges) {
-        bruteForce.add_edge(get<0>(e), get<1>(e), get<2>(e));
+    if(!binaryOut.empty()) {
+        if(!save_binary(binaryOut, graph, terminals)) return 1;
+        cout << "Binary graph written to " << binaryOut << endl;
     }
     
-    bruteForce.set_terminals(terminals);
-    bruteForce.solveSteinerTree();
-    
-    // Get results from brute force
-    double bfTime = bruteForce.getExecutionTime();
-    int bfCost = bruteForce.getMinCost();
-    vector<pair<int,int>> bfTree = bruteForce.getBestSteinerTree();
+    double bfTime = 0, approxTime = 0, mehlhornTime = 0, dwTime = 0;
+    int bfCost = 0, approxCost = 0, mehlhornCost = 0, dwCost = 0;
+    bool bfEnumerated = false;
+    
+    // ALGORITHM 1: BRUTE FORCE
+    if(runBrute) {
+        SteinerTreeBruteForce bruteForce(graph);
+        bruteForce.set_metric_cache(metricCache);
+        
+        bruteForce.set_terminals(terminals);
+        bruteForce.solveSteinerTree();
+        
+        // Get results from brute force
+        bfTime = bruteForce.getExecutionTime();
+        bfCost = tree_cost(graph, bruteForce.getBestSteinerTree(), bruteForce.getMinCost());
+        bfEnumerated = bruteForce.wasEnumerated();
+    }
     
     // ALGORITHM 2: 2-APPROXIMATION
+    if(runApprox) {
+        SteinerTreeApprox approx(graph);
+        approx.set_metric_cache(metricCache);
+        
+        approx.set_terminals(terminals);
+        approx.solveSteinerTree();
+        
+        // Get results from 2-approximation
+        approxTime = approx.getExecutionTime();
+        approxCost = tree_cost(graph, approx.getBestSteinerTree(), approx.getMinCost());
+    }
 
+    // ALGORITHM 3: MEHLHORN 2-APPROXIMATION (no metric closure)
+    if(runMehlhorn) {
+        SteinerTreeMehlhorn mehlhorn(graph);
+        
+        mehlhorn.set_terminals(terminals);
+        mehlhorn.solveSteinerTree();
+        
+        mehlhornTime = mehlhorn.getExecutionTime();
+        mehlhornCost = tree_cost(graph, mehlhorn.getBestSteinerTree(), mehlhorn.getMinCost());
+    }
 
-    SteinerTreeApprox approx(n);
-    
-    for(auto& e : edges) {
-        approx.add_edge(get<0>(e), get<1>(e), get<2>(e));
+    // ALGORITHM 4: DREYFUS-WAGNER (exact, exponential only in the number of terminals)
+    if(runDW) {
+        SteinerTreeDreyfusWagner dreyfusWagner(graph);
+        
+        dreyfusWagner.set_terminals(terminals);
+        dreyfusWagner.solveSteinerTree();
+        
+        dwTime = dreyfusWagner.getExecutionTime();
+        dwCost = tree_cost(graph, dreyfusWagner.getBestSteinerTree(), dreyfusWagner.getMinCost());
     }
-    
-    approx.set_terminals(terminals);
-    approx.solveSteinerTree();
-    
-    // Get results from 2-approximation
-    double approxTime = approx.getExecutionTime();
-    int approxCost = approx.getMinCost();
-    vector<pair<int,int>> approxTree = approx.getBestSteinerTree();
 
     cout << "  COMPARISON RESULTS" << endl;
     
     cout << fixed << setprecision(3);
     cout << "| Algorithm              | Runtime (ms)   | Tree Cost      |" << endl;
     
-    cout << "| Brute Force (Optimal)  | " << setw(14) << bfTime
-         << " | " << setw(14) << bfCost << " |" << endl;
+    if(runBrute && !bfEnumerated)
+        cout << "| Brute Force (Optimal)  | " << setw(14) << "not run"
+             << " | " << setw(14) << "not run" << " |" << endl;
+    else if(runBrute)
+        cout << "| Brute Force (Optimal)  | " << setw(14) << bfTime
+             << " | " << setw(14) << bfCost << " |" << endl;
+    
+    if(runApprox)
+        cout << "| 2-Approximation        | " << setw(14) << approxTime
+             << " | " << setw(14) << approxCost << " |" << endl;
+    
+    if(runMehlhorn)
+        cout << "| Mehlhorn 2-Approx      | " << setw(14) << mehlhornTime
+             << " | " << setw(14) << mehlhornCost << " |" << endl;
     
-    cout << "| 2-Approximation        | " << setw(14) << approxTime
-         << " | " << setw(14) << approxCost << " |" << endl;
+    if(runDW)
+        cout << "| Dreyfus-Wagner (Exact) | " << setw(14) << dwTime
+             << " | " << setw(14) << dwCost << " |" << endl;
     
     return 0;
 }
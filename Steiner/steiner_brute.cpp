@@ -7,47 +7,71 @@
 #include <cmath>
 #include <set>
 #include <map>
+#include <queue>
+#include <thread>
+#include <mutex>
+#include <atomic>
 #include <bits/stdc++.h>
+#include "steiner_graph.cpp"
+#include "steiner_metric.cpp"
+#include "steiner_metric_cache.cpp"
 using namespace std;
 using namespace chrono;
 
+// More candidate Steiner subsets than this are not enumerated (hours of MSTs)
+const double BRUTE_MAX_SUBSETS = 1e10;
+
 class SteinerTreeBruteForce {
 private:
     int n;  // number of vertices
-    vector<vector<int>> graph;   // adjacency matrix of original graph
-    vector<vector<int>> metric;  // metric graph (complete graph with shortest paths)
+    SteinerGraph graph;          // original graph (CSR)
+    Matrix metric;               // metric graph (complete graph with shortest paths)
     vector<int> terminals;       // terminal vertices
     vector<bool> isTerminal;     //  set of  array for terminal vertices
     double executionTime;        // runtime in milliseconds
     int minCost;                 // minimum cost found
+    bool enumerated;             // false if the subsets were too many to enumerate
     vector<pair<int,int>> bestSteinerTree;  // best Steiner tree edges
     vector<int> bestSteinerVertices;        // vertices in best Steiner tree
     vector<pair<int,int>> finalTreeEdges;   // final tree after cycle removal
+    bool verbose;                // print the metric matrix
+    int threads;                 // Floyd-Warshall and enumeration threads (0 = all cores)
+    string cacheDir;             // metric closure cache directory (empty = no cache)
+    
+    // Scratch for path search and tree assembly, sized once and left clean after every use
+    FlatUnionFind dsu;                    // all singletons between uses
+    vector<char> edgeMark;                // per CSR edge id
+    vector<char> vertexMark;
+    vector<int> pathDist, pathParent;     // Dijkstra labels, INT_MAX / -1 between uses
+    vector<int> pathBuf;                  // vertices of the path being expanded
 
 public:
-    SteinerTreeBruteForce(int vertices) {
+    SteinerTreeBruteForce(int vertices) : graph(vertices) {
         n = vertices;
-        graph.resize(n, vector<int>(n, INT_MAX));
-        metric.resize(n, vector<int>(n, INT_MAX));
         isTerminal.resize(n, false);
         executionTime = 0.0;
         minCost = INT_MAX;
-        
-        for(int i = 0; i < n; i++) {
-            graph[i][i] = 0;
-            metric[i][i] = 0;
-        }
+        enumerated = false;
+        verbose = true;
+        threads = 0;
+    }
+    
+    // Solve on an already built graph (shared with the other solvers)
+    SteinerTreeBruteForce(const SteinerGraph& g) : SteinerTreeBruteForce(g.num_vertices()) {
+        graph = g;
     }
     
     void add_edge(int u, int v, int weight) { // adding our actual edges  
-        if(u >= 0 && u < n && v >= 0 && v < n) {
-            graph[u][v] = min(graph[u][v], weight);
-            graph[v][u] = min(graph[v][u], weight);
-        }
+        graph.add_edge(u, v, weight);
     }
     
+    void set_verbose(bool v) { verbose = v; }
+    void set_threads(int t) { threads = t; }
+    void set_metric_cache(const string& dir) { cacheDir = dir; }
+    
     void set_terminals(vector<int>& term) {
         terminals = term;
+        fill(isTerminal.begin(), isTerminal.end(), false);
         for(int t : terminals) {
             if(t >= 0 && t < n) {
                 isTerminal[t] = true;
@@ -62,116 +86,87 @@ public:
     void convert_metric() {
         cout << "\n Converting to Metric Graph using Floyd-Warshall" << endl;
         
-        // Copying  original graph
-        for(int i = 0; i < n; i++) {
-            for(int j = 0; j < n; j++) {
-                metric[i][j] = graph[i][j];
-            }
-        }
-        
-        // Floyd-Warshall algorithm
-        for(int k = 0; k < n; k++) {
-            for(int i = 0; i < n; i++) {
-                for(int j = 0; j < n; j++) {
-                    if(metric[i][k] != INT_MAX && metric[k][j] != INT_MAX) {
-                        if(metric[i][k] + metric[k][j] < metric[i][j]) {
-                            metric[i][j] = metric[i][k] + metric[k][j];
-                        }
-                    }
-                }
-            }
-        }
+        graph.finalize();
+        // blocked, multithreaded Floyd-Warshall (steiner_metric.cpp), or the cached result
+        cached_metric_closure(graph, metric, nullptr, threads, cacheDir);
         
         cout << "Metric Graph computed successfully." << endl;
-        cout << "\nMetric Graph:" << endl;
-        cout << "     ";
-        for(int j = 0; j < n; j++) cout << j << "\t";
-        cout << endl;
-        
-        for(int i = 0; i < n; i++) {
-            cout << i << ":   ";
-            for(int j = 0; j < n; j++) {
-                if(metric[i][j] == INT_MAX)
-                    cout << "INF\t";
-                else
-                    cout << metric[i][j] << "\t";
-            }
-            cout << endl;
+        if(verbose) {
+            cout << "\nMetric Graph:" << endl;
+            print_metric_matrix(metric);
         }
     }
     
-    // Extracting the subgraph from metric graph for given vertex set
-    vector<vector<int>> extract_subgraph(vector<int>& vertices) {
-        int m = vertices.size();
-        vector<vector<int>> subgraph(m, vector<int>(m, INT_MAX));// initiaiting our subgraph 
-        
-        for(int i = 0; i < m; i++) {// adding those crresponding edges to our subgrpah from metric graph
-            for(int j = 0; j < m; j++) {
-                int u = vertices[i];
-                int v = vertices[j];
-                subgraph[i][j] = metric[u][v];
-            }
-        }
-        
-        return subgraph;
-    }
+    // Per-thread buffers for Prim's algorithm, reused across masks
+    struct PrimScratch {
+        vector<int> vertices;
+        vector<int> key;
+        vector<int> parent;
+        vector<char> inMST;
+    };
     
-    // Computing  MST on subgraph using Prim's algorithm 
-    // this function returns MST cost and edges in terms of original vertex indices
-    pair<int, vector<pair<int,int>>> compute_mst_on_subgraph(vector<int>& vertices) {
-        int m = vertices.size();
-        if(m == 0) return {0, {}};
-        
-        vector<vector<int>> subgraph = extract_subgraph(vertices);
-        
-        vector<int> parent(m, -1);
-        vector<int> key(m, INT_MAX);
-        vector<bool> inMST(m, false);
-        
-        key[0] = 0;
-        int mstCost = 0;
-        vector<pair<int,int>> mstEdges;
+    // Cost of the MST on vertices in the metric graph (Prim's algorithm, O(m^2)), or INT_MAX as
+    // soon as the tree built so far costs more than bound (Prim only ever adds edges, so the
+    // partial cost is a lower bound) or the vertices are not connected
+    int mst_cost_bounded(PrimScratch& s, int bound) {
+        int m = s.vertices.size();
+        if(m == 0) return 0;
+        s.key.assign(m, INT_MAX);
+        s.parent.assign(m, -1);
+        s.inMST.assign(m, 0);
+        s.key[0] = 0;
+        long long mstCost = 0;
         
         for(int count = 0; count < m; count++) {
-            // Find minimum key vertex not in MST
             int u = -1;
             int minKey = INT_MAX;
-            
             for(int v = 0; v < m; v++) {
-                if(!inMST[v] && key[v] < minKey) {
-                    minKey = key[v];
+                if(!s.inMST[v] && s.key[v] < minKey) {
+                    minKey = s.key[v];
                     u = v;
                 }
             }
+            if(u == -1) return INT_MAX;     // disconnected
             
-            if(u == -1) break;
-            
-            inMST[u] = true;
+            s.inMST[u] = 1;
+            mstCost += minKey;
+            if(mstCost > bound) return INT_MAX;
             
-            // Add edge to MST
-            if(parent[u] != -1) {
-                int originalU = vertices[parent[u]];
-                int originalV = vertices[u];
-                mstEdges.push_back({originalU, originalV});
-                mstCost += subgraph[parent[u]][u];
-            }
-            
-            // Update keys
+            const int* row = metric[s.vertices[u]];
             for(int v = 0; v < m; v++) {
-                if(!inMST[v] && subgraph[u][v] != INT_MAX && subgraph[u][v] < key[v]) {
-                    key[v] = subgraph[u][v];
-                    parent[v] = u;
+                int w = row[s.vertices[v]];
+                if(!s.inMST[v] && w < s.key[v]) {
+                    s.key[v] = w;
+                    s.parent[v] = u;
                 }
             }
         }
+        return (int)mstCost;
+    }
+    
+    // Computing  MST on subgraph using Prim's algorithm 
+    // this function returns MST cost and edges in terms of original vertex indices
+    pair<int, vector<pair<int,int>>> compute_mst_on_subgraph(vector<int>& vertices) {
+        PrimScratch s;
+        s.vertices = vertices;
+        int mstCost = mst_cost_bounded(s, INT_MAX);
         
+        vector<pair<int,int>> mstEdges;
+        for(int v = 0; v < (int)vertices.size(); v++) {
+            if(s.parent[v] != -1) mstEdges.push_back({vertices[s.parent[v]], vertices[v]});
+        }
         return {mstCost, mstEdges};
     }
     
+    // Non-terminals worth trying as Steiner points. In some optimal tree every Steiner point has
+    // at least three tree neighbors (a point of degree 1 or 2 can be cut out or shortcut), and
+    // its branches leave along distinct original edges, otherwise the neighbor they share would
+    // be an equally good branch point. So vertices of original degree <= 2 are skipped (every
+    // vertex has degree n-1 in the metric closure itself, which says nothing).
     vector<int> get_non_terminals() {
         vector<int> nonTerminals;
         for(int i = 0; i < n; i++) {
-            if(!isTerminal[i]) {
+            if(!isTerminal[i] && graph.degree(i) >= 3) {
                 nonTerminals.push_back(i);
             }
         }
@@ -179,123 +174,227 @@ public:
     }
     
     //Generating  all possible subsets of  non-terminal vertices to make union with the terminal vertices
-    // Generate all subsets of non-terminals using bit masking
+    // Subsets are index combinations of the candidates, enumerated by size and then
+    // lexicographically, and a tree on t terminals has at most t - 2 Steiner points of
+    // degree >= 3, so larger subsets are never generated. Threads take blocks of subsets from a
+    // shared generator and keep their own Prim buffers; the best cost so far is shared so every
+    // MST can stop as soon as it is no better. Ties go to the subset generated first, so the
+    // result does not depend on the number of threads.
     void get_all_subsets() {
         cout << "\n making all Subsets of Non-Terminal Vertices" << endl;
         
         vector<int> nonTerminals = get_non_terminals();
-        int numof_nonTerminals = nonTerminals.size();    
-        int totalSubsets = (1 << numof_nonTerminals);// 2 power of non terminals
+        int numof_nonTerminals = nonTerminals.size();
+        int numTerminals = 0;
+        for(int v = 0; v < n; v++) if(isTerminal[v]) numTerminals++;
+        int maxSteiner = min(numof_nonTerminals, max(0, numTerminals - 2));
+        cout << "Candidate Steiner points (degree >= 3): " << numof_nonTerminals
+             << ", at most " << maxSteiner << " per subset" << endl;
+        double subsets = 0, binom = 1;
+        for(int k = 0; k <= maxSteiner; k++) {
+            subsets += binom;
+            binom = binom * (numof_nonTerminals - k) / (k + 1);
+        }
+        enumerated = subsets <= BRUTE_MAX_SUBSETS;
+        if(!enumerated) {
+            cout << "Too many candidate Steiner subsets for enumeration (" << subsets << ")." << endl;
+            return;
+        }
         
-        for(int k = 0; k < totalSubsets; k++) {
-            // Creating union of terminals and current subset of non-terminals
-            vector<int> currentVertices = terminals;
-            
-            for(int i = 0; i < numof_nonTerminals; i++) {
-                if(k & (1 << i)) {
-                    currentVertices.push_back(nonTerminals[i]);
+        mutex genLock, bestLock;
+        vector<int> comb;                   // next subset, increasing candidate indices
+        unsigned long long nextRank = 0;    // its position in the enumeration
+        bool done = false;
+        atomic<int> incumbent(INT_MAX);     // best cost so far
+        unsigned long long bestRank = 0;
+        vector<int> bestComb;
+        atomic<long long> examined(0), pruned(0);
+        
+        // A block of subsets: subset i is idx[start[i] .. start[i+1]) with position rank[i]
+        struct Block {
+            vector<int> idx, start;
+            vector<unsigned long long> rank;
+        };
+        
+        // hands out up to count subsets in enumeration order
+        auto take = [&](Block& block, int count) {
+            lock_guard<mutex> g(genLock);
+            block.idx.clear();
+            block.start.assign(1, 0);
+            block.rank.clear();
+            while(!done && (int)block.rank.size() < count) {
+                block.idx.insert(block.idx.end(), comb.begin(), comb.end());
+                block.start.push_back(block.idx.size());
+                block.rank.push_back(nextRank++);
+                // advance the rightmost index that can still move, reset the ones after it
+                int k = comb.size(), i = k - 1;
+                while(i >= 0 && comb[i] == numof_nonTerminals - k + i) i--;
+                if(i >= 0) {
+                    comb[i]++;
+                    for(int j = i + 1; j < k; j++) comb[j] = comb[j - 1] + 1;
+                } else if(k + 1 > maxSteiner) {
+                    done = true;
+                } else {
+                    // first subset of the next size
+                    comb.resize(k + 1);
+                    for(int j = 0; j <= k; j++) comb[j] = j;
                 }
             }
-            
-            // Compute MST on this subset
-            auto result = compute_mst_on_subgraph(currentVertices);
-            int currentCost = result.first;
-            vector<pair<int,int>> currentMSTEdges = result.second;
-            
-            // Update best solution if this is better
-            if(currentCost < minCost) {
-                minCost = currentCost;
-                bestSteinerTree = currentMSTEdges;
-                bestSteinerVertices = currentVertices;
+        };
+        
+        auto worker = [&]() {
+            PrimScratch s;
+            Block block;
+            long long ex = 0, pr = 0;
+            while(true) {
+                take(block, 256);
+                if(block.rank.empty()) break;
+                for(size_t b = 0; b < block.rank.size(); b++) {
+                    // Creating union of terminals and current subset of non-terminals
+                    s.vertices.clear();
+                    for(int t : terminals) if(t >= 0 && t < n) s.vertices.push_back(t);
+                    for(int i = block.start[b]; i < block.start[b + 1]; i++) s.vertices.push_back(nonTerminals[block.idx[i]]);
+                    
+                    // Compute MST on this subset, abandoned once it exceeds the incumbent
+                    int currentCost = mst_cost_bounded(s, incumbent.load());
+                    ex++;
+                    if(currentCost == INT_MAX) {
+                        pr++;
+                        continue;
+                    }
+                    
+                    // Update best solution if this is better
+                    lock_guard<mutex> g(bestLock);
+                    if(currentCost < incumbent.load() || (currentCost == incumbent.load() && block.rank[b] < bestRank)) {
+                        incumbent.store(currentCost);
+                        bestRank = block.rank[b];
+                        bestComb.assign(block.idx.begin() + block.start[b], block.idx.begin() + block.start[b + 1]);
+                    }
+                }
             }
+            examined += ex;
+            pruned += pr;
+        };
+        
+        int T = threads > 0 ? threads : max(1u, thread::hardware_concurrency());
+        vector<thread> pool;
+        for(int t = 1; t < T; t++) pool.push_back(thread(worker));
+        worker();
+        for(auto& th : pool) th.join();
+        
+        if(incumbent.load() != INT_MAX) {
+            vector<int> currentVertices;
+            for(int t : terminals) if(t >= 0 && t < n) currentVertices.push_back(t);
+            for(int i : bestComb) currentVertices.push_back(nonTerminals[i]);
+            auto result = compute_mst_on_subgraph(currentVertices);
+            minCost = result.first;
+            bestSteinerTree = result.second;
+            bestSteinerVertices = currentVertices;
         }
         
+        cout << "Subsets examined: " << examined.load() << " (" << pruned.load()
+             << " cut off early by the bound)" << endl;
         cout << "Enumeration complete. Best cost found: " << minCost << endl;
     }
     
+    void prepare_scratch() {
+        if(dsu.num_vertices() != n) dsu.init(n);
+        edgeMark.resize(graph.num_edges(), 0);
+        vertexMark.resize(n, 0);
+        pathDist.resize(n, INT_MAX);
+        pathParent.resize(n, -1);
+    }
+    
     // Reconstructing actual paths in original graph for each metric edge
-    vector<int> find_path_in_original(int u, int v) {
-        // Simple Dijkstra to find actual shortest path
-        vector<int> parent(n, -1);
-        vector<int> dist(n, INT_MAX);
-        vector<bool> visited(n, false);
-        
-        dist[u] = 0;
-        
-        for(int count = 0; count < n; count++) {
-            int minDist = INT_MAX;
-            int current = -1;
+    // Dijkstra from u with a binary heap, stopping at v; the path goes into path (empty if v
+    // is unreachable) and only the labels it touched are reset afterwards
+    void find_path_in_original(int u, int v, vector<int>& path) {
+        prepare_scratch();
+        path.clear();
+        vector<int> touched;
+        priority_queue<pair<int,int>, vector<pair<int,int>>, greater<pair<int,int>>> pq;
+        pathDist[u] = 0;
+        touched.push_back(u);
+        pq.push({0, u});
+        
+        while(!pq.empty()) {
+            int d = pq.top().first;
+            int current = pq.top().second;
+            pq.pop();
+            if(d > pathDist[current]) continue;
+            if(current == v) break;
             
-            for(int i = 0; i < n; i++) {
-                if(!visited[i] && dist[i] < minDist) {
-                    minDist = dist[i];
-                    current = i;
-                }
-            }
-            
-            if(current == -1 || current == v) break;
-            visited[current] = true;
-            
-            for(int next = 0; next < n; next++) {
-                if(graph[current][next] != INT_MAX && graph[current][next] > 0) {
-                    if(dist[current] + graph[current][next] < dist[next]) {
-                        dist[next] = dist[current] + graph[current][next];
-                        parent[next] = current;
-                    }
+            for(int k = graph.begin(current); k < graph.end(current); k++) {
+                int next = graph.neighbor(k);
+                if(d + graph.weight(k) < pathDist[next]) {
+                    if(pathDist[next] == INT_MAX) touched.push_back(next);
+                    pathDist[next] = d + graph.weight(k);
+                    pathParent[next] = current;
+                    pq.push({pathDist[next], next});
                 }
             }
         }
         
         // Reconstruct path
-        vector<int> path;
-        int curr = v;
-        while(curr != -1) {
-            path.push_back(curr);
-            curr = parent[curr];
+        if(pathDist[v] != INT_MAX) {
+            for(int curr = v; curr != -1; curr = pathParent[curr]) path.push_back(curr);
+            reverse(path.begin(), path.end());
+        }
+        for(int x : touched) {
+            pathDist[x] = INT_MAX;
+            pathParent[x] = -1;
         }
-        reverse(path.begin(), path.end());
-        
-        return path;
     }
     
     // Replace metric edges with actual paths and collect all edges
     vector<pair<int,int>> replace_with_actual_paths() {
         cout << "\n=== Replacing Metric Edges with Actual Paths ===" << endl;
         
-        set<pair<int,int>> actualEdgesSet;  // Use set to avoid duplicate edges
-        set<int> allVertices;
+        prepare_scratch();
+        vector<int> edgeIds;       // union of path edges, deduplicated with edgeMark
+        vector<int> allVertices;   // deduplicated with vertexMark
         
         for(auto& edge : bestSteinerTree) {
             int u = edge.first;
             int v = edge.second;
             
             // Find actual path
-            vector<int> path = find_path_in_original(u, v);
+            find_path_in_original(u, v, pathBuf);
             
-            if(path.size() >= 2) {
+            if(pathBuf.size() >= 2) {
                 cout << "Path from " << u << " to " << v << ": ";
-                for(int i = 0; i < (int)path.size() - 1; i++) {
-                    int a = path[i];
-                    int b = path[i+1];
+                for(int i = 0; i < (int)pathBuf.size() - 1; i++) {
+                    int a = pathBuf[i];
+                    int b = pathBuf[i+1];
                     
                     // Add vertices
-                    allVertices.insert(a);
-                    allVertices.insert(b);
+                    for(int x : {a, b}) {
+                        if(!vertexMark[x]) {
+                            vertexMark[x] = 1;
+                            allVertices.push_back(x);
+                        }
+                    }
                     
-                    // Add edge in canonical form (smaller vertex first)
-                    if(a > b) swap(a, b);
-                    actualEdgesSet.insert({a, b});
+                    // Add edge once, by its CSR id
+                    int e = graph.edge_id(graph.find_edge(a, b));
+                    if(!edgeMark[e]) {
+                        edgeMark[e] = 1;
+                        edgeIds.push_back(e);
+                    }
                     
-                    cout << path[i] << " -> ";
+                    cout << pathBuf[i] << " -> ";
                 }
-                cout << path.back() << endl;
+                cout << pathBuf.back() << endl;
             }
         }
+        for(int e : edgeIds) edgeMark[e] = 0;
+        for(int v : allVertices) vertexMark[v] = 0;
         
-        
-        
-        // Convert set to vector
-        vector<pair<int,int>> actualEdges(actualEdgesSet.begin(), actualEdgesSet.end());
+        // edge ids are ordered by (u, v), so this is the sorted edge list
+        sort(edgeIds.begin(), edgeIds.end());
+        vector<pair<int,int>> actualEdges;
+        actualEdges.reserve(edgeIds.size());
+        for(int e : edgeIds) actualEdges.push_back({graph.edge_u(e), graph.edge_v(e)});
         
         // Remove cycles to get final tree
         finalTreeEdges = remove_cycles(actualEdges, allVertices);
@@ -303,52 +402,18 @@ public:
         return finalTreeEdges;
     }
     
-    // Remove cycles using Union-Find to get a valid tree
-    vector<pair<int,int>> remove_cycles(vector<pair<int,int>>& edges, set<int>& vertices) {
+    // Remove cycles using Union-Find to get a valid tree; vertices must contain every
+    // endpoint of edges
+    vector<pair<int,int>> remove_cycles(vector<pair<int,int>>& edges, vector<int>& vertices) {
         cout << "\n=== Removing Cycles to Form Valid Steiner Tree ===" << endl;
         
-        // Union-Find data structure
-        map<int, int> parent;
-        map<int, int> rank;
-        
-        // Initialize Union-Find
-        for(int v : vertices) {
-            parent[v] = v;
-            rank[v] = 0;
-        }
-        
-        // Find with path compression
-        function<int(int)> find = [&](int x) -> int {
-            if(parent[x] != x) {
-                parent[x] = find(parent[x]);
-            }
-            return parent[x];
-        };
-        
-        // Union by rank
-        auto unite = [&](int x, int y) -> bool {
-            int px = find(x);
-            int py = find(y);
-            
-            if(px == py) return false;  // Would create cycle
-            
-            if(rank[px] < rank[py]) {
-                parent[px] = py;
-            } else if(rank[px] > rank[py]) {
-                parent[py] = px;
-            } else {
-                parent[py] = px;
-                rank[px]++;
-            }
-            return true;
-        };
-        
+        prepare_scratch();
         vector<pair<int,int>> treeEdges;
         int cyclesRemoved = 0;
         
         // Add edges one by one, skipping those that create cycles
         for(auto& edge : edges) {
-            if(unite(edge.first, edge.second)) {
+            if(dsu.unite(edge.first, edge.second)) {
                 treeEdges.push_back(edge);
             } else {
                 cout << "  Removing edge " << edge.first << " - " << edge.second 
@@ -356,6 +421,7 @@ public:
                 cyclesRemoved++;
             }
         }
+        dsu.reset(vertices);
         
         if(cyclesRemoved == 0) {
             cout << "No cycles detected. Tree is valid." << endl;
@@ -398,7 +464,7 @@ public:
         cout << "\n=== Final Steiner Tree Edges (after cycle removal) ===" << endl;
         int totalCost = 0;
         for(auto& edge : actualEdges) {
-            int w = graph[edge.first][edge.second];
+            int w = graph.edge_weight(edge.first, edge.second);
             cout << "  " << edge.first << " - " << edge.second 
                  << " (weight: " << w << ")" << endl;
             totalCost += w;
@@ -456,6 +522,7 @@ public:
     int getMinCost() { return minCost; }
     double getExecutionTime() { return executionTime; }
     vector<pair<int,int>> getBestSteinerTree() { return finalTreeEdges; }
+    bool wasEnumerated() { return enumerated; }
 };
 
 
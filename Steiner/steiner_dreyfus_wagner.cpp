@@ -0,0 +1,268 @@
+#include <iostream>
+#include <vector>
+#include <climits>
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <thread>
+#include <atomic>
+#include <bits/stdc++.h>
+#include "steiner_graph.cpp"
+using namespace std;
+using namespace chrono;
+
+// Exact Steiner tree by the Dreyfus-Wagner / Erickson-Monma-Veinott dynamic program, which is
+// exponential only in the number of terminals. One terminal is the root r; for every subset S
+// of the other k = t-1 terminals and every vertex v,
+//   dp[S][v] = cost of the cheapest tree connecting S and v.
+// Singletons are Dijkstra distances. Larger S first merge two trees at the same vertex,
+//   dp[S][v] = min over splits S = A + B of dp[A][v] + dp[B][v],
+// and then let the merge point move along shortest paths with one Dijkstra seeded by those
+// values. The optimum is dp[all][r]. Time O(3^k n + 2^k (m + n log n)), memory 2^k n entries
+// for the table and as many back-pointers (predecessor vertex or split) for reconstruction.
+// Subsets of equal size only depend on smaller ones, so each size is spread across threads.
+const int DW_INF = INT_MAX;       // "unreachable" in the table; sums of two entries are taken in long long
+
+class SteinerTreeDreyfusWagner {
+private:
+    int n;
+    SteinerGraph graph;
+    vector<int> terminals;
+    vector<bool> isTerminal;
+    vector<int> dp;           // dp[S * n + v], DW_INF if unreachable
+    vector<int> back;         // -1: leaf, 0..n-1: predecessor vertex, n + A: split into A and S \ A
+    int threads;              // 0 = all cores
+    double executionTime;
+    int minCost;
+    vector<pair<int,int>> bestSteinerTree;
+    vector<int> bestSteinerVertices;
+
+public:
+    SteinerTreeDreyfusWagner(int vertices) : graph(vertices) {
+        n = vertices;
+        isTerminal.resize(n, false);
+        threads = 0;
+        executionTime = 0.0;
+        minCost = INT_MAX;
+    }
+
+    // Solve on an already built graph (shared with the other solvers)
+    SteinerTreeDreyfusWagner(const SteinerGraph& g) : SteinerTreeDreyfusWagner(g.num_vertices()) {
+        graph = g;
+    }
+
+    void add_edge(int u, int v, int weight) {
+        graph.add_edge(u, v, weight);
+    }
+
+    void set_threads(int t) { threads = t; }
+
+    void set_terminals(vector<int>& term) {
+        terminals.clear();
+        fill(isTerminal.begin(), isTerminal.end(), false);
+        for(int t : term) {
+            if(t >= 0 && t < n && !isTerminal[t]) {
+                isTerminal[t] = true;
+                terminals.push_back(t);
+            }
+        }
+        cout << "Terminal vertices set: ";
+        for(int t : terminals) cout << t << " ";
+        cout << endl;
+    }
+
+    // Dijkstra over row S: every vertex starts at dp[S][v] and may instead be reached from a
+    // neighbor u at dp[S][u] + w(u, v); heap is per-thread scratch
+    void relax_row(int S, vector<pair<int,int>>& heap) {
+        int* row = &dp[(size_t)S * n];
+        int* br = &back[(size_t)S * n];
+        heap.clear();
+        for(int v = 0; v < n; v++) if(row[v] < DW_INF) heap.push_back({-row[v], v});
+        make_heap(heap.begin(), heap.end());
+        while(!heap.empty()) {
+            pop_heap(heap.begin(), heap.end());
+            int d = -heap.back().first, u = heap.back().second;
+            heap.pop_back();
+            if(d > row[u]) continue;
+            for(int k = graph.begin(u); k < graph.end(u); k++) {
+                int v = graph.neighbor(k);
+                long long nd = (long long)d + graph.weight(k);
+                if(nd < row[v]) {
+                    row[v] = (int)nd;
+                    br[v] = u;
+                    heap.push_back({-(int)nd, v});
+                    push_heap(heap.begin(), heap.end());
+                }
+            }
+        }
+    }
+
+    // dp[S][v] = min over splits of dp[A][v] + dp[S \ A][v]; A runs over the proper subsets
+    // that contain S's lowest terminal, so every split is tried once
+    void merge_row(int S) {
+        int* row = &dp[(size_t)S * n];
+        int* br = &back[(size_t)S * n];
+        int low = S & -S;
+        for(int A = (S - 1) & S; A > 0; A = (A - 1) & S) {
+            if(!(A & low)) continue;
+            const int* a = &dp[(size_t)A * n];
+            const int* b = &dp[(size_t)(S ^ A) * n];
+            for(int v = 0; v < n; v++) {
+                long long c = (long long)a[v] + b[v];
+                if(c < row[v]) {
+                    row[v] = (int)c;
+                    br[v] = n + A;
+                }
+            }
+        }
+    }
+
+    void solve_dp() {
+        cout << "\n=== Subset Dynamic Program over Terminals ===" << endl;
+
+        int k = (int)terminals.size() - 1;
+        int full = (1 << k) - 1;
+        dp.assign((size_t)(full + 1) * n, DW_INF);
+        back.assign((size_t)(full + 1) * n, -1);
+
+        int T = threads > 0 ? threads : max(1u, thread::hardware_concurrency());
+        vector<vector<int>> bySize(k + 1);
+        for(int S = 1; S <= full; S++) bySize[__builtin_popcount(S)].push_back(S);
+
+        for(int size = 1; size <= k; size++) {
+            vector<int>& level = bySize[size];
+            atomic<int> next(0);
+            auto worker = [&]() {
+                vector<pair<int,int>> heap;
+                int i;
+                while((i = next.fetch_add(1)) < (int)level.size()) {
+                    int S = level[i];
+                    if(size == 1) dp[(size_t)S * n + terminals[__builtin_ctz(S)]] = 0;
+                    else merge_row(S);
+                    relax_row(S, heap);
+                }
+            };
+            int workers = max(1, min(T, (int)level.size()));
+            vector<thread> pool;
+            for(int t = 1; t < workers; t++) pool.push_back(thread(worker));
+            worker();
+            for(auto& th : pool) th.join();
+            cout << "  subsets of size " << size << ": " << level.size() << " done" << endl;
+        }
+
+        int root = terminals.back();
+        int best = dp[(size_t)full * n + root];
+        minCost = best >= DW_INF ? INT_MAX : best;
+        cout << "Optimal Steiner tree cost: ";
+        if(minCost == INT_MAX) cout << "INF (terminals are not connected)";
+        else cout << minCost;
+        cout << endl;
+    }
+
+    // Follows the back-pointers from (all, root) with an explicit stack
+    void reconstruct_tree() {
+        int k = (int)terminals.size() - 1;
+        int full = (1 << k) - 1;
+        int root = terminals.back();
+        vector<pair<int,int>> edges;
+        vector<pair<int,int>> stack;
+        stack.push_back({full, root});
+        while(!stack.empty()) {
+            int S = stack.back().first, v = stack.back().second;
+            stack.pop_back();
+            // walk predecessor chains iteratively, they can be as long as the graph
+            while(true) {
+                int b = back[(size_t)S * n + v];
+                if(b < 0) break;
+                if(b < n) {
+                    edges.push_back({min(b, v), max(b, v)});
+                    v = b;
+                    continue;
+                }
+                int A = b - n;
+                stack.push_back({A, v});
+                stack.push_back({S ^ A, v});
+                break;
+            }
+        }
+        sort(edges.begin(), edges.end());
+        edges.erase(unique(edges.begin(), edges.end()), edges.end());
+        bestSteinerTree = edges;
+
+        vector<bool> used(n, false);
+        for(auto& e : edges) used[e.first] = used[e.second] = true;
+        for(int t : terminals) used[t] = true;
+        bestSteinerVertices.clear();
+        for(int v = 0; v < n; v++) if(used[v]) bestSteinerVertices.push_back(v);
+    }
+
+    void displaySteinerTree() {
+        cout << "\n=== FINAL STEINER TREE (DREYFUS-WAGNER) ===" << endl;
+
+        cout << "\nTerminal vertices: ";
+        for(int t : terminals) cout << t << " ";
+        cout << endl;
+
+        cout << "\nSteiner vertices used: ";
+        bool hasSteiner = false;
+        for(int v : bestSteinerVertices) {
+            if(!isTerminal[v]) {
+                cout << v << " ";
+                hasSteiner = true;
+            }
+        }
+        if(!hasSteiner) cout << "(none)";
+        cout << endl;
+
+        cout << "\nSteiner Tree edges:" << endl;
+        int totalCost = 0;
+        for(auto& edge : bestSteinerTree) {
+            int w = graph.edge_weight(edge.first, edge.second);
+            cout << "  " << edge.first << " - " << edge.second
+                 << " (weight: " << w << ")" << endl;
+            totalCost += w;
+        }
+
+        cout << "\n=== COST ANALYSIS ===" << endl;
+        cout << "Optimal cost (DP): " << minCost << endl;
+        cout << "Tree cost (actual edges): " << totalCost << endl;
+    }
+
+    void displayRuntime() {
+        cout << "\n=== RUNTIME ANALYSIS ===" << endl;
+        cout << fixed << setprecision(3);
+        cout << "Total Execution Time: " << executionTime << " ms" << endl;
+    }
+
+    void solveSteinerTree() {
+
+        cout << "  STEINER TREE SOLVER - DREYFUS-WAGNER (EXACT)" << endl;
+
+        auto start = high_resolution_clock::now();
+
+        graph.finalize();
+        bestSteinerTree.clear();
+        bestSteinerVertices.clear();
+        int k = (int)terminals.size() - 1;
+        if(k <= 0) {
+            minCost = 0;
+            bestSteinerVertices = terminals;
+        } else if(k > 30 || (double)(1u << k) * n * 2 * sizeof(int) > 8e9) {
+            cout << "Too many terminals for the subset DP (" << terminals.size() << ")." << endl;
+            minCost = INT_MAX;
+        } else {
+            solve_dp();
+            if(minCost != INT_MAX) reconstruct_tree();
+        }
+
+        auto end = high_resolution_clock::now();
+        executionTime = duration_cast<microseconds>(end - start).count() / 1000.0;
+
+        displaySteinerTree();
+        displayRuntime();
+    }
+
+    int getMinCost() { return minCost; }
+    double getExecutionTime() { return executionTime; }
+    vector<pair<int,int>> getBestSteinerTree() { return bestSteinerTree; }
+};
@@ -0,0 +1,172 @@
+#pragma once
+#include <iostream>
+#include <vector>
+#include <climits>
+#include <algorithm>
+#include <tuple>
+#include <cstdint>
+#include <bits/stdc++.h>
+using namespace std;
+
+// Undirected weighted graph in compressed sparse row form, shared by all Steiner solvers.
+// Edges are collected with add_edge and packed by finalize(): parallel edges are reduced to
+// the lightest one and self-loops dropped. Every undirected edge gets an id (0..num_edges-1)
+// and appears once in each endpoint's neighbor list; neighbor lists are sorted by vertex so
+// edge_weight is a binary search. Memory is O(n + m) instead of an n x n matrix.
+class SteinerGraph {
+private:
+    int n;
+    vector<tuple<int,int,int>> pending;  // (u, v, weight) with u < v, not yet packed
+    vector<int> offset;                  // neighbors of u are [offset[u], offset[u+1])
+    vector<int> adjVertex;
+    vector<int> adjWeight;
+    vector<int> adjEdge;                 // edge id of each neighbor entry
+    vector<int> edgeU, edgeV, edgeW;     // edge id -> endpoints (u < v) and weight
+
+public:
+    SteinerGraph(int vertices = 0) {
+        n = vertices;
+        offset.assign(n + 1, 0);
+    }
+
+    void add_edge(int u, int v, int weight) {
+        if(u >= 0 && u < n && v >= 0 && v < n && u != v) {
+            if(u > v) swap(u, v);
+            pending.push_back(make_tuple(u, v, weight));
+        }
+    }
+
+    // Packs all edges added so far (may be called again after more add_edge calls)
+    void finalize() {
+        if(pending.empty()) return;
+        for(int e = 0; e < (int)edgeU.size(); e++) pending.push_back(make_tuple(edgeU[e], edgeV[e], edgeW[e]));
+        sort(pending.begin(), pending.end());
+        edgeU.clear();
+        edgeV.clear();
+        edgeW.clear();
+        for(auto& t : pending) {
+            int u = get<0>(t), v = get<1>(t);
+            if(!edgeU.empty() && edgeU.back() == u && edgeV.back() == v) continue;  // heavier copy
+            edgeU.push_back(u);
+            edgeV.push_back(v);
+            edgeW.push_back(get<2>(t));
+        }
+        pending.clear();
+        pending.shrink_to_fit();
+
+        int m = edgeU.size();
+        offset.assign(n + 1, 0);
+        for(int e = 0; e < m; e++) {
+            offset[edgeU[e] + 1]++;
+            offset[edgeV[e] + 1]++;
+        }
+        for(int u = 0; u < n; u++) offset[u + 1] += offset[u];
+        adjVertex.assign(2 * m, 0);
+        adjWeight.assign(2 * m, 0);
+        adjEdge.assign(2 * m, 0);
+        vector<int> pos(offset.begin(), offset.end() - 1);
+        // edges are sorted by (u, v), so u's larger neighbors arrive in order; smaller
+        // neighbors w < u arrive in order of w too, and all of them before u's own edges
+        for(int e = 0; e < m; e++) {
+            int i = pos[edgeV[e]]++;
+            adjVertex[i] = edgeU[e]; adjWeight[i] = edgeW[e]; adjEdge[i] = e;
+        }
+        for(int e = 0; e < m; e++) {
+            int i = pos[edgeU[e]]++;
+            adjVertex[i] = edgeV[e]; adjWeight[i] = edgeW[e]; adjEdge[i] = e;
+        }
+    }
+
+    int num_vertices() const { return n; }
+    int num_edges() const { return edgeU.size(); }
+
+    // neighbor entries of u are the indices begin(u) .. end(u)-1
+    int begin(int u) const { return offset[u]; }
+    int end(int u) const { return offset[u + 1]; }
+    int degree(int u) const { return offset[u + 1] - offset[u]; }
+    int neighbor(int i) const { return adjVertex[i]; }
+    int weight(int i) const { return adjWeight[i]; }
+    int edge_id(int i) const { return adjEdge[i]; }
+
+    int edge_u(int e) const { return edgeU[e]; }
+    int edge_v(int e) const { return edgeV[e]; }
+    int edge_w(int e) const { return edgeW[e]; }
+
+    // weight of edge u-v, 0 for u == v and INT_MAX if there is no edge
+    int edge_weight(int u, int v) const {
+        if(u == v) return 0;
+        int i = find_edge(u, v);
+        return i < 0 ? INT_MAX : adjWeight[i];
+    }
+
+    // 64-bit hash of the packed edge set (n, then u, v, weight of every edge in id order), so
+    // equal graphs give equal hashes however their edges were added; call after finalize()
+    uint64_t content_hash() const {
+        uint64_t h = 0xcbf29ce484222325ULL;
+        auto mix = [&](uint64_t x) {
+            h ^= x;
+            h *= 0x100000001b3ULL;
+            h ^= h >> 29;
+        };
+        mix(n);
+        mix(edgeU.size());
+        for(int e = 0; e < (int)edgeU.size(); e++) {
+            mix(((uint64_t)edgeU[e] << 32) | (uint32_t)edgeV[e]);
+            mix((uint32_t)edgeW[e]);
+        }
+        return h;
+    }
+
+    // index of v in u's neighbor list, -1 if absent
+    int find_edge(int u, int v) const {
+        auto first = adjVertex.begin() + offset[u], last = adjVertex.begin() + offset[u + 1];
+        auto it = lower_bound(first, last, v);
+        return (it != last && *it == v) ? (int)(it - adjVertex.begin()) : -1;
+    }
+};
+
+// Union-find over vertices 0..n-1 on flat arrays (union by size, path halving). reset() puts
+// just the given vertices back to singletons, so one instance is reused across calls without
+// an O(n) clear.
+class FlatUnionFind {
+private:
+    vector<int> root;
+    vector<int> size;
+
+public:
+    FlatUnionFind(int n = 0) { init(n); }
+
+    void init(int n) {
+        root.resize(n);
+        size.assign(n, 1);
+        for(int v = 0; v < n; v++) root[v] = v;
+    }
+
+    int num_vertices() const { return root.size(); }
+
+    int find(int x) {
+        while(root[x] != x) {
+            root[x] = root[root[x]];
+            x = root[x];
+        }
+        return x;
+    }
+
+    // false if a and b were already in the same set
+    bool unite(int a, int b) {
+        a = find(a);
+        b = find(b);
+        if(a == b) return false;
+        if(size[a] < size[b]) swap(a, b);
+        root[b] = a;
+        size[a] += size[b];
+        return true;
+    }
+
+    void reset(const vector<int>& vertices) {
+        for(int v : vertices) {
+            root[v] = v;
+            size[v] = 1;
+        }
+    }
+};
@@ -0,0 +1,348 @@
+#pragma once
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cstring>
+#include <cstdlib>
+#include <cstdint>
+#include <cstdio>
+#include <cmath>
+#include <bits/stdc++.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "steiner_graph.cpp"
+using namespace std;
+
+// Non-interactive loaders for the comparison tool. Three formats are understood:
+//   .stp  SteinLib: "SECTION Graph" with "Nodes", "Edges"/"Arcs" and "E u v w"/"A u v w" lines,
+//         "SECTION Terminals" with "T v" lines; vertices are 1-based in the file, 0-based here.
+//   .bin  binary edge list, memory-mapped (see BINARY_GRAPH_MAGIC below).
+//   other plain edge list with the same numbers the interactive prompt asks for:
+//         "n m", m lines "u v w" (0-based), then optionally "k" and k terminals; '#' starts a comment.
+// All of them return false and print the reason on failure.
+
+struct SteinerInstance {
+    SteinerGraph graph;
+    vector<int> terminals;
+};
+
+// Memory mapping of a whole file. Read-only by default; with copyOnWrite the pages may be
+// written, but changes stay private to this process and never reach the file.
+class MappedFile {
+private:
+    int fd;
+    void* addr;
+    size_t length;
+
+public:
+    MappedFile() : fd(-1), addr(nullptr), length(0) {}
+    ~MappedFile() { close(); }
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool open(const string& path, bool copyOnWrite = false) {
+        close();
+        fd = ::open(path.c_str(), O_RDONLY);
+        if(fd < 0) return false;
+        struct stat st;
+        if(fstat(fd, &st) != 0) {
+            close();
+            return false;
+        }
+        length = st.st_size;
+        if(length == 0) return true;
+        addr = mmap(nullptr, length, copyOnWrite ? PROT_READ | PROT_WRITE : PROT_READ, MAP_PRIVATE, fd, 0);
+        if(addr == MAP_FAILED) {
+            addr = nullptr;
+            close();
+            return false;
+        }
+        if(!copyOnWrite) madvise(addr, length, MADV_SEQUENTIAL);   // the loaders read front to back
+        return true;
+    }
+
+    void close() {
+        if(addr) munmap(addr, length);
+        if(fd >= 0) ::close(fd);
+        fd = -1;
+        addr = nullptr;
+        length = 0;
+    }
+
+    const char* data() const { return (const char*)addr; }
+    char* data() { return (char*)addr; }
+    size_t size() const { return length; }
+};
+
+// Whitespace-separated token reader over a mapped text file, without copying it
+class TextScanner {
+private:
+    const char* p;
+    const char* end;
+    int lineNo;
+
+public:
+    TextScanner(const char* begin, size_t size) : p(begin), end(begin + size), lineNo(1) {}
+
+    int line() const { return lineNo; }
+
+    // skips blanks, newlines and '#' comments; false at end of file
+    bool skip_space() {
+        while(p < end) {
+            if(*p == '\n') { lineNo++; p++; }
+            else if(*p == ' ' || *p == '\t' || *p == '\r') p++;
+            else if(*p == '#') { while(p < end && *p != '\n') p++; }
+            else return true;
+        }
+        return false;
+    }
+
+    bool next_word(string& w) {
+        if(!skip_space()) return false;
+        const char* s = p;
+        while(p < end && !isspace((unsigned char)*p)) p++;
+        w.assign(s, p);
+        return true;
+    }
+
+    bool next_int(long long& x) {
+        if(!skip_space()) return false;
+        bool neg = false;
+        if(*p == '-' || *p == '+') neg = (*p++ == '-');
+        if(p >= end || !isdigit((unsigned char)*p)) return false;
+        x = 0;
+        while(p < end && isdigit((unsigned char)*p)) x = x * 10 + (*p++ - '0');
+        if(neg) x = -x;
+        return true;
+    }
+
+    // integer weight; a few SteinLib sets store weights like "12.0", which are rounded
+    bool next_weight(long long& x) {
+        if(!skip_space()) return false;
+        const char* s = p;
+        while(p < end && !isspace((unsigned char)*p)) p++;
+        string tok(s, p);
+        char* stop = nullptr;
+        double d = strtod(tok.c_str(), &stop);
+        if(stop == tok.c_str() || *stop != '\0') return false;
+        x = llround(d);
+        return true;
+    }
+
+    void skip_line() {
+        while(p < end && *p != '\n') p++;
+    }
+};
+
+static bool weight_fits(long long w) {
+    return w >= 0 && w < INT_MAX / 2;
+}
+
+// Path lengths are ints with INT_MAX meaning "no path"; when all edges together weigh less
+// than that, every shortest path length fits
+bool total_weight_fits(const SteinerGraph& g) {
+    long long total = 0;
+    for(int e = 0; e < g.num_edges(); e++) total += g.edge_w(e);
+    return total < INT_MAX;
+}
+
+bool load_stp(const string& path, SteinerInstance& inst) {
+    MappedFile file;
+    if(!file.open(path)) {
+        cout << "Cannot open " << path << endl;
+        return false;
+    }
+    TextScanner in(file.data(), file.size());
+    auto fail = [&](const string& why) {
+        cout << path << ":" << in.line() << ": " << why << endl;
+        return false;
+    };
+
+    int n = -1;
+    string word, section;
+    inst.terminals.clear();
+    while(in.next_word(word)) {
+        for(char& c : word) c = toupper((unsigned char)c);
+        if(word == "SECTION") {
+            in.next_word(section);
+            for(char& c : section) c = toupper((unsigned char)c);
+        } else if(word == "END") {
+            section.clear();
+        } else if(word == "EOF") {
+            break;
+        } else if(section == "GRAPH" && word == "NODES") {
+            long long x;
+            if(!in.next_int(x) || x < 0 || x > INT_MAX) return fail("bad node count");
+            n = x;
+            inst.graph = SteinerGraph(n);
+        } else if(section == "GRAPH" && (word == "E" || word == "A")) {
+            long long u, v, w;
+            if(n < 0) return fail("edge before Nodes");
+            if(!in.next_int(u) || !in.next_int(v) || !in.next_weight(w)) return fail("bad edge");
+            if(u < 1 || u > n || v < 1 || v > n) return fail("vertex out of range");
+            if(!weight_fits(w)) return fail("weight out of range");
+            inst.graph.add_edge(u - 1, v - 1, w);
+        } else if(section == "TERMINALS" && word == "T") {
+            long long t;
+            if(!in.next_int(t) || t < 1 || t > n) return fail("bad terminal");
+            inst.terminals.push_back(t - 1);
+        } else {
+            // headers, comments, counts we do not need (Edges, Terminals, Root, coordinates, ...)
+            in.skip_line();
+        }
+    }
+    if(n < 0) return fail("no SECTION Graph with a Nodes line");
+    inst.graph.finalize();
+    if(!total_weight_fits(inst.graph)) return fail("edge weights add up to INT_MAX or more");
+    return true;
+}
+
+bool load_edge_list(const string& path, SteinerInstance& inst) {
+    MappedFile file;
+    if(!file.open(path)) {
+        cout << "Cannot open " << path << endl;
+        return false;
+    }
+    TextScanner in(file.data(), file.size());
+    auto fail = [&](const string& why) {
+        cout << path << ":" << in.line() << ": " << why << endl;
+        return false;
+    };
+
+    long long n, m;
+    if(!in.next_int(n) || !in.next_int(m) || n < 0 || n > INT_MAX || m < 0) return fail("expected \"n m\"");
+    inst.graph = SteinerGraph(n);
+    for(long long i = 0; i < m; i++) {
+        long long u, v, w;
+        if(!in.next_int(u) || !in.next_int(v) || !in.next_weight(w)) return fail("expected \"u v w\"");
+        if(u < 0 || u >= n || v < 0 || v >= n) return fail("vertex out of range");
+        if(!weight_fits(w)) return fail("weight out of range");
+        inst.graph.add_edge(u, v, w);
+    }
+    inst.terminals.clear();
+    long long k;
+    if(in.next_int(k)) {
+        for(long long i = 0; i < k; i++) {
+            long long t;
+            if(!in.next_int(t) || t < 0 || t >= n) return fail("bad terminal");
+            inst.terminals.push_back(t);
+        }
+    }
+    inst.graph.finalize();
+    if(!total_weight_fits(inst.graph)) return fail("edge weights add up to INT_MAX or more");
+    return true;
+}
+
+// Binary edge list, native byte order:
+//   char magic[4] = "STBG"; uint32 version = 1; uint32 n; uint32 k; uint64 m;
+//   m x { int32 u, v, w }  (0-based), then k x int32 terminal
+const char BINARY_GRAPH_MAGIC[4] = {'S', 'T', 'B', 'G'};
+const uint32_t BINARY_GRAPH_VERSION = 1;
+
+struct BinaryGraphHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t n;
+    uint32_t k;
+    uint64_t m;
+};
+
+bool load_binary(const string& path, SteinerInstance& inst) {
+    MappedFile file;
+    if(!file.open(path)) {
+        cout << "Cannot open " << path << endl;
+        return false;
+    }
+    BinaryGraphHeader h;
+    if(file.size() < sizeof(h)) {
+        cout << path << ": too short for a binary graph header" << endl;
+        return false;
+    }
+    memcpy(&h, file.data(), sizeof(h));
+    if(memcmp(h.magic, BINARY_GRAPH_MAGIC, 4) != 0 || h.version != BINARY_GRAPH_VERSION) {
+        cout << path << ": not a version " << BINARY_GRAPH_VERSION << " binary graph" << endl;
+        return false;
+    }
+    if(h.n > (uint32_t)INT_MAX || h.m > (file.size() - sizeof(h)) / 12
+       || file.size() != sizeof(h) + h.m * 12 + (uint64_t)h.k * 4) {
+        cout << path << ": size does not match the header" << endl;
+        return false;
+    }
+
+    const char* p = file.data() + sizeof(h);
+    inst.graph = SteinerGraph(h.n);
+    for(uint64_t i = 0; i < h.m; i++, p += 12) {
+        int32_t e[3];
+        memcpy(e, p, 12);
+        if(e[0] < 0 || e[0] >= (int)h.n || e[1] < 0 || e[1] >= (int)h.n || !weight_fits(e[2])) {
+            cout << path << ": edge " << i << " is out of range" << endl;
+            return false;
+        }
+        inst.graph.add_edge(e[0], e[1], e[2]);
+    }
+    inst.terminals.assign(h.k, 0);
+    if(h.k) memcpy(inst.terminals.data(), p, (size_t)h.k * 4);
+    for(int t : inst.terminals) {
+        if(t < 0 || t >= (int)h.n) {
+            cout << path << ": terminal " << t << " is out of range" << endl;
+            return false;
+        }
+    }
+    inst.graph.finalize();
+    if(!total_weight_fits(inst.graph)) {
+        cout << path << ": edge weights add up to INT_MAX or more" << endl;
+        return false;
+    }
+    return true;
+}
+
+bool save_binary(const string& path, const SteinerGraph& g, const vector<int>& terminals) {
+    FILE* f = fopen(path.c_str(), "wb");
+    if(!f) {
+        cout << "Cannot write " << path << endl;
+        return false;
+    }
+    BinaryGraphHeader h;
+    memcpy(h.magic, BINARY_GRAPH_MAGIC, 4);
+    h.version = BINARY_GRAPH_VERSION;
+    h.n = g.num_vertices();
+    h.k = terminals.size();
+    h.m = g.num_edges();
+    bool ok = fwrite(&h, sizeof(h), 1, f) == 1;
+    vector<int32_t> buf;
+    buf.reserve(3 * 4096);
+    for(int e = 0; e < g.num_edges() && ok; e++) {
+        buf.push_back(g.edge_u(e));
+        buf.push_back(g.edge_v(e));
+        buf.push_back(g.edge_w(e));
+        if(buf.size() == buf.capacity() || e + 1 == g.num_edges()) {
+            ok = fwrite(buf.data(), 4, buf.size(), f) == buf.size();
+            buf.clear();
+        }
+    }
+    if(ok && !terminals.empty()) ok = fwrite(terminals.data(), 4, terminals.size(), f) == terminals.size();
+    if(fclose(f) != 0) ok = false;
+    if(!ok) cout << "Error while writing " << path << endl;
+    return ok;
+}
+
+// Picks the loader from the file: binary magic first, then the .stp extension or a
+// SteinLib header, otherwise a plain edge list
+bool load_instance(const string& path, SteinerInstance& inst) {
+    char head[64] = {0};
+    FILE* f = fopen(path.c_str(), "rb");
+    if(!f) {
+        cout << "Cannot open " << path << endl;
+        return false;
+    }
+    size_t got = fread(head, 1, sizeof(head) - 1, f);
+    fclose(f);
+
+    if(got >= 4 && memcmp(head, BINARY_GRAPH_MAGIC, 4) == 0) return load_binary(path, inst);
+    string ext = path.size() >= 4 ? path.substr(path.size() - 4) : "";
+    for(char& c : ext) c = tolower((unsigned char)c);
+    if(ext == ".stp" || strstr(head, "STP File") || strstr(head, "SECTION")) return load_stp(path, inst);
+    return load_edge_list(path, inst);
+}
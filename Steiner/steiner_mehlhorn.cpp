@@ -0,0 +1,313 @@
+#include <iostream>
+#include <vector>
+#include <climits>
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <queue>
+#include <bits/stdc++.h>
+#include "steiner_graph.cpp"
+using namespace std;
+using namespace chrono;
+
+// Mehlhorn's 2-approximation: the same guarantee as SteinerTreeApprox, but instead of the full
+// metric closure it runs one Dijkstra from all terminals at once (every vertex learns its
+// nearest terminal, i.e. its Voronoi cell), turns each edge between two cells into a candidate
+// edge between their terminals, and takes the MST of those candidates. O(m + n log n) time and
+// O(n + m) memory, so only the CSR graph is stored.
+class SteinerTreeMehlhorn {
+private:
+    int n;
+    SteinerGraph graph;
+    vector<int> terminals;
+    vector<bool> isTerminal;
+    vector<long long> dist;              // distance to the nearest terminal
+    vector<int> source;                  // nearest terminal (Voronoi cell), -1 if unreachable
+    vector<int> pred;                    // previous vertex on the shortest path from source
+    double executionTime;
+    int minCost;                         // cost of the final tree (actual edges)
+    long long networkCost;               // MST cost in the terminal distance network
+    vector<pair<int,int>> bestSteinerTree;
+    vector<int> bestSteinerVertices;
+
+    struct BoundaryEdge {
+        long long cost;
+        int s, t;        // terminals
+        int u, v;        // graph edge realizing it, u in cell s and v in cell t
+    };
+
+public:
+    SteinerTreeMehlhorn(int vertices) : graph(vertices) {
+        n = vertices;
+        isTerminal.resize(n, false);
+        executionTime = 0.0;
+        minCost = INT_MAX;
+        networkCost = 0;
+    }
+
+    // Solve on an already built graph (shared with the other solvers)
+    SteinerTreeMehlhorn(const SteinerGraph& g) : SteinerTreeMehlhorn(g.num_vertices()) {
+        graph = g;
+    }
+
+    void add_edge(int u, int v, int weight) {
+        graph.add_edge(u, v, weight);
+    }
+
+    void set_terminals(vector<int>& term) {
+        terminals.clear();
+        fill(isTerminal.begin(), isTerminal.end(), false);
+        for(int t : term) {
+            if(t >= 0 && t < n && !isTerminal[t]) {
+                isTerminal[t] = true;
+                terminals.push_back(t);
+            }
+        }
+        cout << "Terminal vertices (R) set: ";
+        for(int t : terminals) cout << t << " ";
+        cout << endl;
+    }
+
+    // Step 1: multi-source Dijkstra from all terminals
+    void compute_voronoi_cells() {
+        cout << "\n=== Step 1: Multi-Source Dijkstra from Terminals ===" << endl;
+
+        graph.finalize();
+        dist.assign(n, LLONG_MAX);
+        source.assign(n, -1);
+        pred.assign(n, -1);
+        priority_queue<pair<long long,int>, vector<pair<long long,int>>, greater<pair<long long,int>>> pq;
+        for(int t : terminals) {
+            dist[t] = 0;
+            source[t] = t;
+            pq.push({0, t});
+        }
+        while(!pq.empty()) {
+            long long d = pq.top().first;
+            int u = pq.top().second;
+            pq.pop();
+            if(d > dist[u]) continue;
+            for(int k = graph.begin(u); k < graph.end(u); k++) {
+                int v = graph.neighbor(k);
+                long long nd = d + graph.weight(k);
+                if(nd < dist[v]) {
+                    dist[v] = nd;
+                    source[v] = source[u];
+                    pred[v] = u;
+                    pq.push({nd, v});
+                }
+            }
+        }
+
+        int reached = 0;
+        for(int v = 0; v < n; v++) if(source[v] != -1) reached++;
+        cout << "Voronoi cells computed: " << reached << " of " << n
+             << " vertices reachable from a terminal." << endl;
+    }
+
+    // Step 2: edges between two Voronoi cells give candidate terminal-terminal edges of cost
+    // dist[u] + w + dist[v]; only the cheapest per terminal pair is kept
+    vector<BoundaryEdge> build_boundary_graph() {
+        cout << "\n=== Step 2: Building Voronoi Boundary Graph ===" << endl;
+
+        vector<BoundaryEdge> cand;
+        for(int u = 0; u < n; u++) {
+            if(source[u] == -1) continue;
+            for(int k = graph.begin(u); k < graph.end(u); k++) {
+                int v = graph.neighbor(k);
+                if(v < u || source[v] == -1 || source[u] == source[v]) continue;
+                BoundaryEdge b{dist[u] + graph.weight(k) + dist[v], source[u], source[v], u, v};
+                if(b.s > b.t) { swap(b.s, b.t); swap(b.u, b.v); }
+                cand.push_back(b);
+            }
+        }
+        sort(cand.begin(), cand.end(), [](const BoundaryEdge& a, const BoundaryEdge& b) {
+            if(a.s != b.s) return a.s < b.s;
+            if(a.t != b.t) return a.t < b.t;
+            return a.cost < b.cost;
+        });
+        vector<BoundaryEdge> boundary;
+        for(auto& b : cand) {
+            if(boundary.empty() || boundary.back().s != b.s || boundary.back().t != b.t) boundary.push_back(b);
+        }
+
+        cout << "Boundary graph has " << boundary.size() << " terminal pairs (from "
+             << cand.size() << " cell-crossing edges)." << endl;
+        return boundary;
+    }
+
+    // Step 3: Kruskal on the boundary graph
+    vector<BoundaryEdge> compute_mst_on_terminals(vector<BoundaryEdge>& boundary) {
+        cout << "\n=== Step 3: Computing MST of the Boundary Graph ===" << endl;
+
+        sort(boundary.begin(), boundary.end(), [](const BoundaryEdge& a, const BoundaryEdge& b) {
+            return a.cost < b.cost;
+        });
+        vector<int> root(n);
+        for(int i = 0; i < n; i++) root[i] = i;
+        auto find = [&](int x) {
+            while(root[x] != x) {
+                root[x] = root[root[x]];
+                x = root[x];
+            }
+            return x;
+        };
+
+        vector<BoundaryEdge> mst;
+        networkCost = 0;
+        for(auto& b : boundary) {
+            int a = find(b.s), c = find(b.t);
+            if(a == c) continue;
+            root[a] = c;
+            mst.push_back(b);
+            networkCost += b.cost;
+        }
+
+        cout << "MST on terminals computed with cost: " << networkCost << endl;
+        for(auto& b : mst) {
+            cout << "  " << b.s << " - " << b.t << " (distance: " << b.cost
+                 << ", via edge " << b.u << " - " << b.v << ")" << endl;
+        }
+        return mst;
+    }
+
+    // Step 4: expand each MST edge into source[u] ~> u - v ~> source[v], then take an MST of the
+    // union and repeatedly drop non-terminal leaves
+    void expand_and_prune(vector<BoundaryEdge>& mst) {
+        cout << "\n=== Step 4: Expanding Paths and Pruning ===" << endl;
+
+        vector<tuple<int,int,int>> edges;   // (weight, a, b) with a < b
+        auto add = [&](int a, int b) {
+            if(a > b) swap(a, b);
+            edges.push_back({graph.edge_weight(a, b), a, b});
+        };
+        for(auto& b : mst) {
+            for(int x = b.u; pred[x] != -1; x = pred[x]) add(x, pred[x]);
+            for(int x = b.v; pred[x] != -1; x = pred[x]) add(x, pred[x]);
+            add(b.u, b.v);
+        }
+        sort(edges.begin(), edges.end());
+        edges.erase(unique(edges.begin(), edges.end()), edges.end());
+
+        // MST of the expanded subgraph
+        vector<int> root(n);
+        for(int i = 0; i < n; i++) root[i] = i;
+        auto find = [&](int x) {
+            while(root[x] != x) {
+                root[x] = root[root[x]];
+                x = root[x];
+            }
+            return x;
+        };
+        vector<tuple<int,int,int>> tree;
+        for(auto& e : edges) {
+            int a = find(get<1>(e)), c = find(get<2>(e));
+            if(a == c) continue;
+            root[a] = c;
+            tree.push_back(e);
+        }
+
+        // prune non-terminal leaves
+        vector<int> degree(n, 0);
+        vector<vector<int>> incident(n);
+        for(int i = 0; i < (int)tree.size(); i++) {
+            degree[get<1>(tree[i])]++;
+            degree[get<2>(tree[i])]++;
+            incident[get<1>(tree[i])].push_back(i);
+            incident[get<2>(tree[i])].push_back(i);
+        }
+        vector<bool> removed(tree.size(), false);
+        vector<int> leaves;
+        for(int v = 0; v < n; v++) if(degree[v] == 1 && !isTerminal[v]) leaves.push_back(v);
+        int pruned = 0;
+        while(!leaves.empty()) {
+            int v = leaves.back();
+            leaves.pop_back();
+            for(int i : incident[v]) {
+                if(removed[i]) continue;
+                removed[i] = true;
+                pruned++;
+                int w = get<1>(tree[i]) == v ? get<2>(tree[i]) : get<1>(tree[i]);
+                degree[v]--;
+                if(--degree[w] == 1 && !isTerminal[w]) leaves.push_back(w);
+            }
+        }
+
+        bestSteinerTree.clear();
+        bestSteinerVertices.clear();
+        minCost = 0;
+        vector<bool> used(n, false);
+        for(int i = 0; i < (int)tree.size(); i++) {
+            if(removed[i]) continue;
+            int a = get<1>(tree[i]), b = get<2>(tree[i]);
+            bestSteinerTree.push_back({a, b});
+            minCost += get<0>(tree[i]);
+            used[a] = used[b] = true;
+        }
+        for(int t : terminals) used[t] = true;
+        for(int v = 0; v < n; v++) if(used[v]) bestSteinerVertices.push_back(v);
+
+        cout << "Expanded subgraph has " << edges.size() << " edges; " << pruned
+             << " non-terminal leaf edge(s) pruned." << endl;
+    }
+
+    void displaySteinerTree() {
+        cout << "\n=== Step 5: OUTPUT - Final Steiner Tree T ===" << endl;
+
+        cout << "\nTerminal vertices (R): ";
+        for(int t : terminals) cout << t << " ";
+        cout << endl;
+
+        cout << "\nSteiner vertices used: ";
+        bool hasSteiner = false;
+        for(int v : bestSteinerVertices) {
+            if(!isTerminal[v]) {
+                cout << v << " ";
+                hasSteiner = true;
+            }
+        }
+        if(!hasSteiner) cout << "(none)";
+        cout << endl;
+
+        cout << "\nFinal Steiner Tree edges:" << endl;
+        for(auto& edge : bestSteinerTree) {
+            cout << "  " << edge.first << " - " << edge.second
+                 << " (weight: " << graph.edge_weight(edge.first, edge.second) << ")" << endl;
+        }
+
+        cout << "\n=== STEINER TREE COST ===" << endl;
+        cout << "MST on terminals cost (distance network): " << networkCost << endl;
+        cout << "Final tree cost (actual edges): " << minCost << endl;
+    }
+
+    void displayRuntime() {
+        cout << "\n=== RUNTIME ANALYSIS ===" << endl;
+        cout << fixed << setprecision(3);
+        cout << "Total Execution Time: " << executionTime << " ms" << endl;
+    }
+
+    void solveSteinerTree() {
+
+        cout << "  STEINER TREE - MEHLHORN 2-APPROXIMATION" << endl;
+
+        auto start = high_resolution_clock::now();
+
+        compute_voronoi_cells();
+
+        vector<BoundaryEdge> boundary = build_boundary_graph();
+
+        vector<BoundaryEdge> mst = compute_mst_on_terminals(boundary);
+
+        expand_and_prune(mst);
+
+        auto end = high_resolution_clock::now();
+        executionTime = duration_cast<microseconds>(end - start).count() / 1000.0;
+
+        displaySteinerTree();
+        displayRuntime();
+    }
+
+    int getMinCost() { return minCost; }
+    double getExecutionTime() { return executionTime; }
+    vector<pair<int,int>> getBestSteinerTree() { return bestSteinerTree; }
+};
@@ -0,0 +1,237 @@
+#pragma once
+#include <iostream>
+#include <vector>
+#include <climits>
+#include <algorithm>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <memory>
+#include <bits/stdc++.h>
+#include "steiner_graph.cpp"
+using namespace std;
+
+// n x n int matrix in one contiguous row-major block; m[i] is a pointer to row i, so m[i][j]
+// reads like the old vector<vector<int>> but rows are adjacent in memory. The block is either
+// owned or a view of memory kept alive by someone else (a cache file mapping, see
+// steiner_metric_cache.cpp); copies are always owned.
+class Matrix {
+private:
+    int n;
+    vector<int> a;
+    int* p;                      // a.data(), or the viewed block
+    shared_ptr<void> backing;    // owner of the viewed block, null if a is used
+
+public:
+    Matrix(int size = 0, int value = 0) : n(size), a((size_t)size * size, value), p(a.data()) {}
+
+    Matrix(const Matrix& o) : n(o.n), a(o.p, o.p + (size_t)o.n * o.n), p(a.data()) {}
+
+    Matrix& operator=(const Matrix& o) {
+        if(this != &o) {
+            a.assign(o.p, o.p + (size_t)o.n * o.n);
+            n = o.n;
+            p = a.data();
+            backing.reset();
+        }
+        return *this;
+    }
+
+    void assign(int size, int value) {
+        n = size;
+        backing.reset();
+        a.assign((size_t)size * size, value);
+        p = a.data();
+    }
+
+    // Use size x size ints at data instead of own storage; owner keeps them valid
+    void view(int size, int* data, shared_ptr<void> owner) {
+        n = size;
+        vector<int>().swap(a);
+        p = data;
+        backing = owner;
+    }
+
+    int size() const { return n; }
+    int* operator[](int i) { return p + (size_t)i * n; }
+    const int* operator[](int i) const { return p + (size_t)i * n; }
+    int* data() { return p; }
+    const int* data() const { return p; }
+};
+
+// Reusable barrier for a fixed number of threads
+class Barrier {
+private:
+    mutex mtx;
+    condition_variable cv;
+    int count, waiting, generation;
+
+public:
+    Barrier(int threads) : count(threads), waiting(0), generation(0) {}
+
+    void wait() {
+        unique_lock<mutex> lock(mtx);
+        int gen = generation;
+        if(++waiting == count) {
+            waiting = 0;
+            generation++;
+            cv.notify_all();
+        } else {
+            cv.wait(lock, [&] { return gen != generation; });
+        }
+    }
+};
+
+// Blocked Floyd-Warshall on dist. Missing edges are INT_MAX on entry and on exit; a path
+// whose length does not fit below INT_MAX stays "no path" (the loaders reject such graphs).
+//
+// The min-plus runs on the entries as unsigned ints: two values up to INT_MAX add up to at
+// most 2^32 - 2, so the sum never wraps, and a sum involving INT_MAX is never below an
+// existing entry. The inner loop needs no INT_MAX checks and vectorizes. The matrix is cut
+// into FW_TILE x FW_TILE tiles; for each diagonal tile kb the classic three phases run: the diagonal
+// tile itself, then the tiles in row kb and column kb (independent of each other), then all
+// remaining tiles (independent as well). Phases 2 and 3 are spread across threads, with a
+// barrier between phases.
+//
+// Parents are not tracked here: with zero-weight edges and the tiles visited out of the naive
+// k order, "last improving k" parents can point at each other. shortest_path_parents derives
+// them from the final distances instead.
+const int FW_TILE = 64;
+
+inline void fw_tile(Matrix& d, int ib, int jb, int kb, int n) {
+    int iEnd = min(ib + FW_TILE, n), jEnd = min(jb + FW_TILE, n), kEnd = min(kb + FW_TILE, n);
+    for(int k = kb; k < kEnd; k++) {
+        const unsigned* dk = (const unsigned*)d[k];
+        for(int i = ib; i < iEnd; i++) {
+            unsigned* di = (unsigned*)d[i];
+            unsigned dik = di[k];
+            for(int j = jb; j < jEnd; j++) di[j] = min(di[j], dik + dk[j]);
+        }
+    }
+}
+
+// Runs body(t) for t = 0..threads-1, body(0) on the calling thread
+template<class Body>
+void run_threads(int threads, Body body) {
+    vector<thread> pool;
+    for(int t = 1; t < threads; t++) pool.push_back(thread(body, t));
+    body(0);
+    for(auto& th : pool) th.join();
+}
+
+void blocked_floyd_warshall(Matrix& dist, int threads = 0) {
+    int n = dist.size();
+
+    int tiles = (n + FW_TILE - 1) / FW_TILE;
+    if(threads <= 0) threads = max(1u, thread::hardware_concurrency());
+    threads = max(1, min(threads, tiles * tiles));
+    Barrier barrier(threads);
+
+    run_threads(threads, [&](int t) {
+        for(int kt = 0; kt < tiles; kt++) {
+            int kb = kt * FW_TILE;
+            // phase 1: the diagonal tile
+            if(t == 0) fw_tile(dist, kb, kb, kb, n);
+            barrier.wait();
+            // phase 2: row kt and column kt
+            for(int x = t; x < 2 * tiles; x += threads) {
+                int other = x % tiles;
+                if(other == kt) continue;
+                if(x < tiles) fw_tile(dist, kb, other * FW_TILE, kb, n);
+                else fw_tile(dist, other * FW_TILE, kb, kb, n);
+            }
+            barrier.wait();
+            // phase 3: everything else
+            for(int x = t; x < tiles * tiles; x += threads) {
+                int it = x / tiles, jt = x % tiles;
+                if(it == kt || jt == kt) continue;
+                fw_tile(dist, it * FW_TILE, jt * FW_TILE, kb, n);
+            }
+            barrier.wait();
+        }
+    });
+}
+
+// parent[s][v] = vertex before v on a shortest s-v path, from the final distances: a neighbor u
+// with dist[s][u] + w(u, v) == dist[s][v]. An edge with w > 0 is preferred, since u is then
+// strictly closer to s; vertices reached only over zero-weight edges are attached by a
+// breadth-first search from the vertices already placed. Every parent chain therefore ends at s
+// without cycles. parent[s][s] = s, -1 if v is unreachable. O(n + m) per source.
+void shortest_path_parents(const SteinerGraph& g, const Matrix& dist, Matrix& parent, int threads = 0) {
+    int n = g.num_vertices();
+    parent.assign(n, -1);
+    if(threads <= 0) threads = max(1u, thread::hardware_concurrency());
+    threads = max(1, min(threads, n));
+
+    run_threads(threads, [&](int t) {
+        vector<int> queue;
+        queue.reserve(n);
+        for(int s = t; s < n; s += threads) {
+            const int* ds = dist[s];
+            int* ps = parent[s];
+            queue.clear();
+            for(int v = 0; v < n; v++) {
+                if(ds[v] == INT_MAX) continue;
+                if(v == s) {
+                    ps[v] = s;
+                } else {
+                    for(int k = g.begin(v); k < g.end(v); k++) {
+                        int u = g.neighbor(k), w = g.weight(k);
+                        if(w > 0 && ds[u] != INT_MAX && (long long)ds[u] + w == ds[v]) {
+                            ps[v] = u;
+                            break;
+                        }
+                    }
+                }
+                if(ps[v] >= 0) queue.push_back(v);
+            }
+            // a zero-weight edge joins two vertices at the same distance from s
+            for(size_t q = 0; q < queue.size(); q++) {
+                int u = queue[q];
+                for(int k = g.begin(u); k < g.end(u); k++) {
+                    int v = g.neighbor(k);
+                    if(g.weight(k) == 0 && ps[v] < 0) {
+                        ps[v] = u;
+                        queue.push_back(v);
+                    }
+                }
+            }
+        }
+    });
+}
+
+// Metric closure of g: dist[i][j] = shortest path length (INT_MAX if unreachable) and, if
+// parent is given, parent[i][j] = vertex before j on that path (parent[i][i] = i).
+void compute_metric_closure(const SteinerGraph& g, Matrix& dist, Matrix* parent, int threads = 0) {
+    int n = g.num_vertices();
+    dist.assign(n, INT_MAX);
+    for(int i = 0; i < n; i++) {
+        dist[i][i] = 0;
+        for(int k = g.begin(i); k < g.end(i); k++) dist[i][g.neighbor(k)] = g.weight(k);
+    }
+    blocked_floyd_warshall(dist, threads);
+    if(parent) shortest_path_parents(g, dist, *parent, threads);
+}
+
+// Prints an n x n distance matrix, or a note when it is too large to be readable
+void print_metric_matrix(Matrix& dist, int maxSize = 30) {
+    int n = dist.size();
+    if(n > maxSize) {
+        cout << "(" << n << " x " << n << " matrix not shown)" << endl;
+        return;
+    }
+    cout << "     ";
+    for(int j = 0; j < n; j++) cout << j << "\t";
+    cout << endl;
+
+    for(int i = 0; i < n; i++) {
+        cout << i << ":   ";
+        for(int j = 0; j < n; j++) {
+            if(dist[i][j] == INT_MAX)
+                cout << "INF\t";
+            else
+                cout << dist[i][j] << "\t";
+        }
+        cout << endl;
+    }
+}
@@ -0,0 +1,100 @@
+#pragma once
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cstring>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <bits/stdc++.h>
+#include <unistd.h>
+#include "steiner_graph.cpp"
+#include "steiner_metric.cpp"
+#include "steiner_io.cpp"
+using namespace std;
+
+// On-disk cache of metric closures, so repeated runs on the same graph skip Floyd-Warshall.
+// One file per graph, named after SteinerGraph::content_hash() in the cache directory:
+//   MetricCacheHeader (32 bytes), n*n int32 distances, then n*n int32 parents if present.
+// A hit maps the file copy-on-write and the Matrix objects view it directly, so loading
+// costs only the page faults of the entries actually read. Files with another version,
+// another graph or without the parent matrix when one is needed are ignored and rewritten.
+const char METRIC_CACHE_MAGIC[4] = {'S', 'T', 'M', 'C'};
+const uint32_t METRIC_CACHE_VERSION = 2;   // 1 could hold cyclic parents (zero-weight edges)
+
+struct MetricCacheHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t n;
+    uint32_t hasParent;
+    uint64_t graphHash;
+    uint64_t numEdges;
+};
+
+string metric_cache_path(const string& dir, const SteinerGraph& g) {
+    char name[32];
+    snprintf(name, sizeof(name), "metric_%016llx.bin", (unsigned long long)g.content_hash());
+    return dir.empty() ? string(name) : dir + "/" + name;
+}
+
+// Fills dist (and parent, if given) from the cache file; false on any mismatch
+bool load_metric_cache(const string& path, const SteinerGraph& g, Matrix& dist, Matrix* parent) {
+    shared_ptr<MappedFile> file = make_shared<MappedFile>();
+    if(!file->open(path, true)) return false;
+
+    MetricCacheHeader h;
+    if(file->size() < sizeof(h)) return false;
+    memcpy(&h, file->data(), sizeof(h));
+    size_t n = g.num_vertices();
+    size_t cells = n * n;
+    if(memcmp(h.magic, METRIC_CACHE_MAGIC, 4) != 0 || h.version != METRIC_CACHE_VERSION
+       || h.n != n || h.graphHash != g.content_hash() || h.numEdges != (uint64_t)g.num_edges()
+       || (parent && !h.hasParent)
+       || file->size() != sizeof(h) + cells * 4 * (h.hasParent ? 2 : 1)) return false;
+
+    int* d = (int*)(file->data() + sizeof(h));
+    dist.view(n, d, file);
+    if(parent) parent->view(n, d + cells, file);
+    return true;
+}
+
+// Writes dist (and parent, if given) next to the final path and renames it into place, so
+// a concurrent reader never sees a half-written file
+bool save_metric_cache(const string& path, const SteinerGraph& g, const Matrix& dist, const Matrix* parent) {
+    string tmp = path + ".tmp" + to_string(getpid());
+    FILE* f = fopen(tmp.c_str(), "wb");
+    if(!f) return false;
+
+    MetricCacheHeader h;
+    memcpy(h.magic, METRIC_CACHE_MAGIC, 4);
+    h.version = METRIC_CACHE_VERSION;
+    h.n = g.num_vertices();
+    h.hasParent = parent != nullptr;
+    h.graphHash = g.content_hash();
+    h.numEdges = g.num_edges();
+    size_t cells = (size_t)h.n * h.n;
+    bool ok = fwrite(&h, sizeof(h), 1, f) == 1;
+    if(ok) ok = fwrite(dist.data(), 4, cells, f) == cells;
+    if(ok && parent) ok = fwrite(parent->data(), 4, cells, f) == cells;
+    if(fclose(f) != 0) ok = false;
+    if(ok) ok = rename(tmp.c_str(), path.c_str()) == 0;
+    if(!ok) remove(tmp.c_str());
+    return ok;
+}
+
+// compute_metric_closure backed by the cache directory cacheDir (no caching if it is empty)
+void cached_metric_closure(const SteinerGraph& g, Matrix& dist, Matrix* parent, int threads,
+                           const string& cacheDir) {
+    if(cacheDir.empty()) {
+        compute_metric_closure(g, dist, parent, threads);
+        return;
+    }
+    string path = metric_cache_path(cacheDir, g);
+    if(load_metric_cache(path, g, dist, parent)) {
+        cout << "Metric closure loaded from cache " << path << endl;
+        return;
+    }
+    compute_metric_closure(g, dist, parent, threads);
+    if(save_metric_cache(path, g, dist, parent)) cout << "Metric closure saved to cache " << path << endl;
+    else cout << "Could not write metric cache " << path << endl;
+}
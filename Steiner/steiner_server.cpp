@@ -0,0 +1,358 @@
+#pragma once
+#include <iostream>
+#include <vector>
+#include <string>
+#include <sstream>
+#include <cstring>
+#include <cstdio>
+#include <cerrno>
+#include <deque>
+#include <map>
+#include <set>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include <chrono>
+#include <bits/stdc++.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "steiner_tree_approx.cpp"
+using namespace std;
+using namespace chrono;
+
+// Long-running query mode: the graph is loaded and its metric closure computed once
+// (SteinerTreeApprox::prepare), then terminal sets are answered as they arrive, each costing
+// only the MST on the terminals and the path expansion. Queries come one per line, either on
+// stdin (answers on stdout) or from clients of a Unix socket, and are solved by a pool of
+// worker threads. Every client gets its answers in the order it sent the queries.
+//
+// Protocol, one line each way:
+//   "t1 t2 ... tk"  ->  "OK cost=<tree cost> mst=<metric MST cost> time_ms=<latency> edges=u-v u-v ..."
+//                       (cost=INF when the terminals are not connected)
+//   "stats"         ->  "STATS queries=... errors=... qps=... latency_ms p50=... p95=... p99=... max=..."
+//   "shutdown"      ->  "BYE"; nothing after it is read from that client (in stdio mode this ends
+//                       the input), and a socket server stops accepting clients
+//   anything else   ->  "ERR <reason>"
+// The latency of a query is measured from reading its line to finishing its answer, so it
+// includes the time spent waiting for a free worker.
+
+// Latency counts in logarithmic buckets, so memory and the cost of a percentile stay constant
+// however many queries are answered. Bucket 0 holds everything below 1 us; above that each
+// power of two is split into SUB buckets, so a percentile is off by at most 1/SUB (about 6%).
+class LatencyHistogram {
+private:
+    static const int SUB = 16;
+    static const int OCTAVES = 40;       // up to 2^40 us, about 12 days
+    vector<long long> counts;
+    long long total;
+    double maxMs;
+
+    static int bucket(double ms) {
+        double us = ms * 1000.0;
+        if(us < 1.0) return 0;
+        int e;
+        double m = frexp(us, &e);        // us = m * 2^e, 0.5 <= m < 1
+        int b = 1 + (e - 1) * SUB + (int)((2 * m - 1) * SUB);
+        return min(b, OCTAVES * SUB);
+    }
+
+    // upper end of bucket b in ms
+    static double upper(int b) {
+        if(b == 0) return 0.001;
+        int e = (b - 1) / SUB, sub = (b - 1) % SUB;
+        return ldexp(1.0 + (sub + 1.0) / SUB, e) / 1000.0;
+    }
+
+public:
+    LatencyHistogram() : counts(OCTAVES * SUB + 1, 0), total(0), maxMs(0) {}
+
+    void add(double ms) {
+        counts[bucket(ms)]++;
+        total++;
+        maxMs = max(maxMs, ms);
+    }
+
+    long long count() const { return total; }
+    double max_ms() const { return maxMs; }
+
+    // smallest bucket bound with at least p of the latencies at or below it, never above the max
+    double percentile(double p) const {
+        if(total == 0) return 0.0;
+        long long need = max(1LL, (long long)ceil(p * total)), seen = 0;
+        for(int b = 0; b < (int)counts.size(); b++) {
+            seen += counts[b];
+            if(seen >= need) return min(upper(b), maxMs);
+        }
+        return maxMs;
+    }
+};
+
+class SteinerQueryServer {
+private:
+    const SteinerTreeApprox& solver;
+    int vertices;
+    int workers;                         // 0 = all cores
+
+    // One client; answers are written in query order even if workers finish out of order
+    struct Connection {
+        int fd;
+        bool isSocket;
+        mutex mtx;
+        long long nextSeq;               // next answer to write
+        map<long long, string> ready;    // finished answers waiting for earlier ones
+
+        Connection(int f, bool sock) : fd(f), isSocket(sock), nextSeq(0) {}
+        ~Connection() { if(isSocket) close(fd); }
+
+        void reply(long long seq, const string& line) {
+            lock_guard<mutex> g(mtx);
+            ready[seq] = line;
+            while(!ready.empty() && ready.begin()->first == nextSeq) {
+                write_all(ready.begin()->second + "\n");
+                ready.erase(ready.begin());
+                nextSeq++;
+            }
+        }
+
+        void write_all(const string& s) {
+            size_t off = 0;
+            while(off < s.size()) {
+                ssize_t w = isSocket ? send(fd, s.data() + off, s.size() - off, MSG_NOSIGNAL)
+                                     : write(fd, s.data() + off, s.size() - off);
+                if(w < 0 && errno == EINTR) continue;
+                if(w <= 0) return;           // client went away; drop the answer
+                off += w;
+            }
+        }
+    };
+
+    struct Job {
+        shared_ptr<Connection> conn;
+        long long seq;
+        string line;
+        steady_clock::time_point arrived;
+    };
+
+    mutex queueMtx;
+    condition_variable queueCv;
+    deque<Job> queue;
+    bool closing;
+
+    mutex statsMtx;
+    LatencyHistogram latencies;          // ms of every answered query
+    long long errors;
+    steady_clock::time_point started;
+
+    atomic<bool> stopping;               // set by "shutdown"
+    int listenFd;
+    mutex clientsMtx;
+    condition_variable clientsCv;        // signalled when a reader finishes
+    set<int> clientFds;                  // sockets whose reader is still running
+
+    void submit(Job job) {
+        {
+            lock_guard<mutex> g(queueMtx);
+            queue.push_back(move(job));
+        }
+        queueCv.notify_one();
+    }
+
+    // blocks until a job is available; false once the queue is closed and empty
+    bool next_job(Job& job) {
+        unique_lock<mutex> lock(queueMtx);
+        queueCv.wait(lock, [&] { return closing || !queue.empty(); });
+        if(queue.empty()) return false;
+        job = move(queue.front());
+        queue.pop_front();
+        return true;
+    }
+
+    void close_queue() {
+        {
+            lock_guard<mutex> g(queueMtx);
+            closing = true;
+        }
+        queueCv.notify_all();
+    }
+
+    static string format_cost(int c) {
+        return c == INT_MAX ? string("INF") : to_string(c);
+    }
+
+    void worker_loop() {
+        Job job;
+        while(next_job(job)) {
+            string answer;
+            stringstream in(job.line);
+            string first;
+            in >> first;
+            if(first == "stats") {
+                answer = stats_line();
+            } else if(first == "shutdown") {
+                answer = "BYE";
+                request_stop();
+            } else {
+                vector<int> term;
+                stringstream parse(job.line);
+                long long t;
+                bool ok = true;
+                while(parse >> t) {
+                    if(t < 0 || t >= vertices) { ok = false; break; }
+                    term.push_back(t);
+                }
+                if(ok && !parse.eof()) ok = false;
+                if(!ok) {
+                    answer = "ERR expected vertex ids 0.." + to_string(vertices - 1);
+                    lock_guard<mutex> g(statsMtx);
+                    errors++;
+                } else {
+                    SteinerQueryResult r = solver.query(term);
+                    double ms = duration_cast<microseconds>(steady_clock::now() - job.arrived).count() / 1000.0;
+                    char head[128];
+                    snprintf(head, sizeof(head), "OK cost=%s mst=%s time_ms=%.3f edges=",
+                             format_cost(r.metricCost == INT_MAX ? INT_MAX : r.treeCost).c_str(),
+                             format_cost(r.metricCost).c_str(), ms);
+                    answer = head;
+                    for(size_t i = 0; i < r.edges.size(); i++) {
+                        if(i) answer += ' ';
+                        answer += to_string(r.edges[i].first) + "-" + to_string(r.edges[i].second);
+                    }
+                    lock_guard<mutex> g(statsMtx);
+                    latencies.add(ms);
+                }
+            }
+            job.conn->reply(job.seq, answer);
+        }
+    }
+
+    static bool is_shutdown(const string& line) {
+        stringstream in(line);
+        string first;
+        in >> first;
+        return first == "shutdown";
+    }
+
+    // splits everything read from fd into lines and queues them for conn, up to end of input or
+    // a "shutdown" line
+    void read_lines(int fd, shared_ptr<Connection> conn) {
+        long long seq = 0;
+        string pending;
+        char buf[1 << 16];
+        while(true) {
+            ssize_t got = read(fd, buf, sizeof(buf));
+            if(got < 0 && errno == EINTR) continue;
+            if(got <= 0) break;
+            pending.append(buf, got);
+            size_t start = 0, nl;
+            while((nl = pending.find('\n', start)) != string::npos) {
+                string line = pending.substr(start, nl - start);
+                start = nl + 1;
+                if(!line.empty() && line.back() == '\r') line.pop_back();
+                if(line.find_first_not_of(" \t") == string::npos) continue;
+                submit(Job{conn, seq++, line, steady_clock::now()});
+                if(is_shutdown(line)) return;
+            }
+            pending.erase(0, start);
+        }
+        if(pending.find_first_not_of(" \t\r") != string::npos) submit(Job{conn, seq++, pending, steady_clock::now()});
+    }
+
+    void request_stop() {
+        if(stopping.exchange(true)) return;
+        if(listenFd >= 0) shutdown(listenFd, SHUT_RDWR);   // wakes up accept()
+    }
+
+    vector<thread> start_workers() {
+        int T = workers > 0 ? workers : max(1u, thread::hardware_concurrency());
+        vector<thread> pool;
+        for(int t = 0; t < T; t++) pool.push_back(thread(&SteinerQueryServer::worker_loop, this));
+        return pool;
+    }
+
+public:
+    SteinerQueryServer(const SteinerTreeApprox& s, int n, int threads = 0)
+        : solver(s), vertices(n), workers(threads), closing(false), errors(0), stopping(false), listenFd(-1) {
+        started = steady_clock::now();
+    }
+
+    string stats_line() {
+        char out[256];
+        lock_guard<mutex> g(statsMtx);
+        double secs = duration_cast<microseconds>(steady_clock::now() - started).count() / 1e6;
+        long long q = latencies.count();
+        snprintf(out, sizeof(out), "STATS queries=%lld errors=%lld qps=%.1f latency_ms p50=%.3f p95=%.3f p99=%.3f max=%.3f",
+                 q, errors, secs > 0 ? q / secs : 0.0, latencies.percentile(0.50), latencies.percentile(0.95),
+                 latencies.percentile(0.99), latencies.max_ms());
+        return out;
+    }
+
+    // Queries from stdin, answers on stdout, until end of input or "shutdown"
+    void serve_stdio() {
+        vector<thread> pool = start_workers();
+        shared_ptr<Connection> conn = make_shared<Connection>(1, false);
+        read_lines(0, conn);
+        close_queue();
+        for(auto& th : pool) th.join();
+        cerr << stats_line() << endl;
+    }
+
+    // Queries from clients of the Unix socket at path, until a client sends "shutdown"
+    bool serve_socket(const string& path) {
+        sockaddr_un addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        if(path.size() >= sizeof(addr.sun_path)) {
+            cerr << "Socket path too long: " << path << endl;
+            return false;
+        }
+        strcpy(addr.sun_path, path.c_str());
+        listenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+        unlink(path.c_str());
+        if(listenFd < 0 || bind(listenFd, (sockaddr*)&addr, sizeof(addr)) != 0 || listen(listenFd, 64) != 0) {
+            cerr << "Cannot listen on " << path << ": " << strerror(errno) << endl;
+            if(listenFd >= 0) close(listenFd);
+            listenFd = -1;
+            return false;
+        }
+        cerr << "Listening on " << path << endl;
+
+        vector<thread> pool = start_workers();
+        while(!stopping) {
+            int fd = accept(listenFd, nullptr, nullptr);
+            if(fd < 0) {
+                if(errno == EINTR) continue;
+                break;
+            }
+            {
+                lock_guard<mutex> g(clientsMtx);
+                clientFds.insert(fd);
+            }
+            // readers are detached so a finished client leaves nothing behind; the fd is erased
+            // while conn still holds it open, so a new client cannot reuse the number meanwhile
+            thread([this, fd]() {
+                shared_ptr<Connection> conn = make_shared<Connection>(fd, true);
+                read_lines(fd, conn);
+                lock_guard<mutex> g(clientsMtx);
+                clientFds.erase(fd);
+                clientsCv.notify_all();
+            }).detach();
+        }
+        {
+            // stop reading from clients that are still connected and wait for their readers;
+            // their queued queries are answered
+            unique_lock<mutex> lock(clientsMtx);
+            for(int fd : clientFds) shutdown(fd, SHUT_RD);
+            clientsCv.wait(lock, [&] { return clientFds.empty(); });
+        }
+        close_queue();
+        for(auto& th : pool) th.join();
+        close(listenFd);
+        listenFd = -1;
+        unlink(path.c_str());
+        cerr << stats_line() << endl;
+        return true;
+    }
+};
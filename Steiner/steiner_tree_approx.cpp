@@ -7,47 +7,84 @@
 #include <cmath>
 #include <set>
 #include <bits/stdc++.h>
+#include "steiner_graph.cpp"
+#include "steiner_metric.cpp"
+#include "steiner_metric_cache.cpp"
 using namespace std;
 using namespace chrono;
 
+// Answer to one SteinerTreeApprox::query
+struct SteinerQueryResult {
+    int metricCost;                  // MST cost on the terminals in the metric, INT_MAX if not connected
+    int treeCost;                    // cost of the final tree in the original graph
+    vector<pair<int,int>> edges;     // final tree edges (u < v)
+};
+
 class SteinerTreeApprox {
 private:
     int n;  
-    vector<vector<int>> graph;  
-    vector<vector<int>> metric;  
-    vector<vector<int>> parent;  
+    SteinerGraph graph;  
+    Matrix metric;  
+    Matrix parent;  
     vector<int> terminals;      
     vector<bool> isTerminal;     
     double executionTime;        
     int minCost;                 
     vector<pair<int,int>> bestSteinerTree; 
     vector<int> bestSteinerVertices;   
+    bool verbose;                // print the distance matrices
+    int threads;                 // Floyd-Warshall threads (0 = all cores)
+    string cacheDir;             // metric closure cache directory (empty = no cache)
+    uint64_t metricHash;         // graph.content_hash() the metric closure was computed for
+    
+    // Incremental state (add_terminal / remove_terminal)
+    bool incremental;                     // the fields below describe the current terminals
+    vector<pair<int,int>> terminalTree;   // MST of K_R as terminal pairs (a forest if R is not connected)
+    vector<int> pathRef;                  // per CSR edge id: number of terminalTree paths through it
+    vector<int> pathEdges;                // edge ids with pathRef > 0
+    vector<int> pathPos;                  // position of each edge id in pathEdges, -1 if absent
+    
+    // Scratch for tree assembly, sized once and left clean after every use
+    FlatUnionFind dsu;                    // all singletons between uses
+    vector<char> edgeMark;                // per CSR edge id
+    vector<char> vertexMark;
+    vector<int> pathBuf;                  // vertices of the path being expanded
+    vector<int> compIndex;                // per vertex, -1 between uses
 
 public:
-    SteinerTreeApprox(int vertices) {
+    SteinerTreeApprox(int vertices) : graph(vertices) {
         n = vertices;
-        graph.resize(n, vector<int>(n, INT_MAX));
-        metric.resize(n, vector<int>(n, INT_MAX));
-        parent.resize(n, vector<int>(n, -1));
         isTerminal.resize(n, false);
         executionTime = 0.0;
         minCost = INT_MAX;
-        
-        for(int i = 0; i < n; i++) {
-            graph[i][i] = 0;
-            metric[i][i] = 0;
-            parent[i][i] = i;
-        }
+        verbose = true;
+        threads = 0;
+        metricHash = 0;
+        incremental = false;
+    }
+    
+    // Solve on an already built graph (shared with the other solvers)
+    SteinerTreeApprox(const SteinerGraph& g) : SteinerTreeApprox(g.num_vertices()) {
+        graph = g;
     }
     
     void add_edge(int u, int v, int weight) {
-        if(u >= 0 && u < n && v >= 0 && v < n) {
-            graph[u][v] = min(graph[u][v], weight);
-            graph[v][u] = min(graph[v][u], weight);
-        }
+        graph.add_edge(u, v, weight);
+        incremental = false;
     }
     
+    void set_verbose(bool v) { verbose = v; }
+    void set_threads(int t) { threads = t; }
+    void set_metric_cache(const string& dir) { cacheDir = dir; }
+    
     void set_terminals(vector<int>& term) {
+        // a new terminal set: the incremental state and the old flags no longer apply
+        incremental = false;
+        terminalTree.clear();
+        pathRef.clear();
+        pathEdges.clear();
+        pathPos.clear();
+        fill(isTerminal.begin(), isTerminal.end(), false);
         terminals = term;
         for(int t : terminals) {
             if(t >= 0 && t < n) {
@@ -64,44 +101,16 @@ public:
     void convert_metric() {
         cout << "\n=== Step 1: Computing Metric Closure ===" << endl;
    
-        for(int i = 0; i < n; i++) {
-            for(int j = 0; j < n; j++) {
-                metric[i][j] = graph[i][j];
-                if(i != j && graph[i][j] != INT_MAX) {
-                    parent[i][j] = i;  // direct edge
-                }
-            }
-        }
-        
-        // Floyd-Warshall algorithm with path reconstruction
-        for(int k = 0; k < n; k++) {
-            for(int i = 0; i < n; i++) {
-                for(int j = 0; j < n; j++) {
-                    if(metric[i][k] != INT_MAX && metric[k][j] != INT_MAX) {
-                        if(metric[i][k] + metric[k][j] < metric[i][j]) {
-                            metric[i][j] = metric[i][k] + metric[k][j];
-                            parent[i][j] = parent[k][j]; 
-                        }
-                    }
-                }
-            }
-        }
+        graph.finalize();
+        // blocked, multithreaded Floyd-Warshall with path reconstruction (steiner_metric.cpp),
+        // or the cached result
+        cached_metric_closure(graph, metric, &parent, threads, cacheDir);
+        metricHash = graph.content_hash();
         
         cout << "Metric closure computed successfully." << endl;
-        cout << "\nMetric Graph (all-pairs shortest distances):" << endl;
-        cout << "     ";
-        for(int j = 0; j < n; j++) cout << j << "\t";
-        cout << endl;
-        
-        for(int i = 0; i < n; i++) {
-            cout << i << ":   ";
-            for(int j = 0; j < n; j++) {
-                if(metric[i][j] == INT_MAX)
-                    cout << "INF\t";
-                else
-                    cout << metric[i][j] << "\t";
-            }
-            cout << endl;
+        if(verbose) {
+            cout << "\nMetric Graph (all-pairs shortest distances):" << endl;
+            print_metric_matrix(metric);
         }
     }
     
@@ -121,6 +130,7 @@ public:
         }
         
         cout << "Complete graph K_R formed with " << m << " terminals." << endl;
+        if(!verbose || m > 30) return KR;
         cout << "\nK_R adjacency matrix:" << endl;
         cout << "     ";
         for(int j = 0; j < m; j++) cout << terminals[j] << "\t";
@@ -197,115 +207,94 @@ public:
         return mstEdges;
     }
     
-    // Reconstruct shortest path from u to v using parent matrix
-    vector<int> reconstruct_path(int u, int v) {
-        if(metric[u][v] == INT_MAX) return {};
-        
-        vector<int> path;
-        function<void(int, int)> build_path = [&](int s, int t) {
-            if(s == t) {
-                path.push_back(s);
-                return;
-            }
-            build_path(s, parent[s][t]);
-            path.push_back(t);
-        };
-        
-        build_path(u, v);
-        return path;
+    void prepare_scratch() {
+        if(dsu.num_vertices() != n) dsu.init(n);
+        edgeMark.resize(graph.num_edges(), 0);
+        vertexMark.resize(n, 0);
+        compIndex.resize(n, -1);
+    }
+    
+    // Reconstruct shortest path from u to v using parent matrix, into path (empty if there
+    // is none); walks back from v, so it needs no recursion however long the path is
+    void reconstruct_path(int u, int v, vector<int>& path) {
+        path.clear();
+        if(metric[u][v] == INT_MAX) return;
+        const int* pu = parent[u];
+        for(int x = v; x != u; x = pu[x]) path.push_back(x);
+        path.push_back(u);
+        reverse(path.begin(), path.end());
     }
     
     // Step 4: Replace each MST edge with shortest path and remove cycles
     vector<pair<int,int>> replace_with_shortest_paths(vector<pair<int,int>>& mstEdges) {
         cout << "\n=== Step 4: Replacing MST Edges with Shortest Paths ===" << endl;
         
-        set<pair<int,int>> allEdges;  
-        set<int> allVertices;
+        prepare_scratch();
+        vector<int> edgeIds;       // union of path edges, deduplicated with edgeMark
+        vector<int> allVertices;   // deduplicated with vertexMark
         
         for(auto& edge : mstEdges) {
             int u = edge.first;
             int v = edge.second;
             
-
-            vector<int> path = reconstruct_path(u, v);
+            reconstruct_path(u, v, pathBuf);
             
             cout << "Shortest path from " << u << " to " << v << ": ";
-            for(int i = 0; i < (int)path.size(); i++) {
-                cout << path[i];
-                if(i < (int)path.size() - 1) cout << " -> ";
-                allVertices.insert(path[i]);
+            for(int i = 0; i < (int)pathBuf.size(); i++) {
+                cout << pathBuf[i];
+                if(i < (int)pathBuf.size() - 1) cout << " -> ";
+                if(!vertexMark[pathBuf[i]]) {
+                    vertexMark[pathBuf[i]] = 1;
+                    allVertices.push_back(pathBuf[i]);
+                }
             }
             cout << endl;
             
-   
-            for(int i = 0; i < (int)path.size() - 1; i++) {
-                int a = path[i];
-                int b = path[i+1];
-          
-                if(a > b) swap(a, b);
-                allEdges.insert({a, b});
+            for(int i = 0; i < (int)pathBuf.size() - 1; i++) {
+                int e = graph.edge_id(graph.find_edge(pathBuf[i], pathBuf[i+1]));
+                if(!edgeMark[e]) {
+                    edgeMark[e] = 1;
+                    edgeIds.push_back(e);
+                }
             }
         }
-
-        vector<pair<int,int>> pathEdges(allEdges.begin(), allEdges.end());
+        for(int e : edgeIds) edgeMark[e] = 0;
+        for(int v : allVertices) vertexMark[v] = 0;
         
-        cout << "\nUnion of all shortest paths contains " << allEdges.size() 
+        // edge ids are ordered by (u, v), so this is the sorted edge list
+        sort(edgeIds.begin(), edgeIds.end());
+        sort(allVertices.begin(), allVertices.end());
+        vector<pair<int,int>> pathEdges;
+        pathEdges.reserve(edgeIds.size());
+        for(int e : edgeIds) pathEdges.push_back({graph.edge_u(e), graph.edge_v(e)});
+        
+        cout << "\nUnion of all shortest paths contains " << pathEdges.size() 
              << " edges and " << allVertices.size() << " vertices." << endl;
         
         vector<pair<int,int>> finalTree = remove_cycles(pathEdges, allVertices);
         
         bestSteinerTree = finalTree;
-        bestSteinerVertices = vector<int>(allVertices.begin(), allVertices.end());
+        bestSteinerVertices = allVertices;
         
         return finalTree;
     }
     
-    vector<pair<int,int>> remove_cycles(vector<pair<int,int>>& edges, set<int>& vertices) {
+    // vertices must contain every endpoint of edges
+    vector<pair<int,int>> remove_cycles(vector<pair<int,int>>& edges, vector<int>& vertices) {
         cout << "\n=== Removing Cycles to Form Tree T ===" << endl;
         
-        // Use Union-Find to detect and remove cycles
-        map<int, int> parent;
-        map<int, int> rank;
-        
-        for(int v : vertices) {
-            parent[v] = v;
-            rank[v] = 0;
-        }
-        
-        function<int(int)> find = [&](int x) {
-            if(parent[x] != x) {
-                parent[x] = find(parent[x]);
-            }
-            return parent[x];
-        };
-        
-        auto unite = [&](int x, int y) -> bool {
-            int px = find(x);
-            int py = find(y);
-            
-            if(px == py) return false; 
-            
-            if(rank[px] < rank[py]) {
-                parent[px] = py;
-            } else if(rank[px] > rank[py]) {
-                parent[py] = px;
-            } else {
-                parent[py] = px;
-                rank[px]++;
-            }
-            return true;
-        };
-        
+        prepare_scratch();
         vector<pair<int,int>> treeEdges;
         
         for(auto& edge : edges) {
-            if(unite(edge.first, edge.second)) {
+            if(dsu.unite(edge.first, edge.second)) {
                 treeEdges.push_back(edge);
             } else {
                 cout << "  Removing edge " << edge.first << " - " << edge.second 
                      << " (creates cycle)" << endl;
             }
         }
+        dsu.reset(vertices);
         
         cout << "Tree T formed with " << treeEdges.size() << " edges." << endl;
         
@@ -333,7 +322,7 @@ public:
         cout << "\nFinal Steiner Tree edges:" << endl;
         int totalCost = 0;
         for(auto& edge : bestSteinerTree) {
-            int w = graph[edge.first][edge.second];
+            int w = graph.edge_weight(edge.first, edge.second);
             cout << "  " << edge.first << " - " << edge.second 
                  << " (weight: " << w << ")" << endl;
             totalCost += w;
@@ -351,6 +340,7 @@ public:
     }
     
     void solveSteinerTree() {
+        incremental = false;
         
         cout << "  STEINER TREE - 2-APPROXIMATION ALGORITHM" << endl;
         
@@ -371,6 +361,281 @@ public:
         displayRuntime();
     }
     
+    // Multi-query use: prepare() computes the metric closure once, after which query() answers
+    // one terminal set from it without touching the solver's state, so it is const and any
+    // number of threads may call it at the same time
+    void prepare() {
+        convert_metric();
+    }
+    
+    // Prim on K_R over the vertices R; a spanning forest (and connected = false) if some of them
+    // cannot reach each other. Edges are (tree parent, vertex) pairs of original vertex ids.
+    vector<pair<int,int>> terminal_mst(const vector<int>& R, bool& connected) const {
+        int m = R.size();
+        vector<int> key(m, INT_MAX), parentMST(m, -1);
+        vector<char> inMST(m, 0);
+        vector<pair<int,int>> mst;
+        connected = true;
+        for(int count = 0; count < m; count++) {
+            int u = -1;
+            for(int v = 0; v < m; v++) if(!inMST[v] && (u == -1 || key[v] < key[u])) u = v;
+            if(count > 0 && key[u] == INT_MAX) connected = false;   // starts another component
+            inMST[u] = 1;
+            if(parentMST[u] != -1) mst.push_back({R[parentMST[u]], R[u]});
+            const int* row = metric[R[u]];
+            for(int v = 0; v < m; v++) {
+                if(!inMST[v] && row[R[v]] < key[v]) {
+                    key[v] = row[R[v]];
+                    parentMST[v] = u;
+                }
+            }
+        }
+        return mst;
+    }
+    
+    SteinerQueryResult query(const vector<int>& term) const {
+        SteinerQueryResult res;
+        res.metricCost = 0;
+        res.treeCost = 0;
+        
+        vector<int> R;
+        for(int t : term) if(t >= 0 && t < n) R.push_back(t);
+        sort(R.begin(), R.end());
+        R.erase(unique(R.begin(), R.end()), R.end());
+        if(R.size() <= 1) return res;
+        
+        bool connected;
+        vector<pair<int,int>> mst = terminal_mst(R, connected);
+        if(!connected) {
+            res.metricCost = INT_MAX;
+            return res;
+        }
+        vector<pair<int,int>> pathEdges;
+        for(auto& e : mst) {
+            res.metricCost += metric[e.first][e.second];
+            // shortest path e.first ~> e.second, walked back through the parent matrix
+            const int* ps = parent[e.first];
+            for(int x = e.second; x != e.first; x = ps[x]) pathEdges.push_back({min(x, ps[x]), max(x, ps[x])});
+        }
+        
+        // union of the paths, minus the edges that close a cycle
+        sort(pathEdges.begin(), pathEdges.end());
+        pathEdges.erase(unique(pathEdges.begin(), pathEdges.end()), pathEdges.end());
+        vector<int> verts;
+        for(auto& e : pathEdges) {
+            verts.push_back(e.first);
+            verts.push_back(e.second);
+        }
+        sort(verts.begin(), verts.end());
+        verts.erase(unique(verts.begin(), verts.end()), verts.end());
+        vector<int> root(verts.size());
+        for(int i = 0; i < (int)root.size(); i++) root[i] = i;
+        auto find = [&](int x) {
+            while(root[x] != x) {
+                root[x] = root[root[x]];
+                x = root[x];
+            }
+            return x;
+        };
+        auto index = [&](int v) { return (int)(lower_bound(verts.begin(), verts.end(), v) - verts.begin()); };
+        for(auto& e : pathEdges) {
+            int a = find(index(e.first)), b = find(index(e.second));
+            if(a == b) continue;
+            root[a] = b;
+            res.edges.push_back(e);
+            res.treeCost += graph.edge_weight(e.first, e.second);
+        }
+        return res;
+    }
+    
+    // Incremental maintenance: add_terminal / remove_terminal keep the MST of K_R up to date
+    // and re-expand only the shortest paths of the MST edges that changed. Every path edge
+    // carries a count of the MST paths using it, so the union of paths is updated in time
+    // proportional to the changed paths; only the final cycle removal walks the whole union.
+    // The result is the same MST-of-the-metric tree as a fresh solve, so the 2-approximation
+    // bound holds after every update. The metric closure is computed on the first update.
+    
+    // adds (delta = 1) or removes (delta = -1) the shortest path s ~> t to the union of paths
+    void expand_path(int s, int t, int delta) {
+        const int* ps = parent[s];
+        for(int x = t; x != s; x = ps[x]) {
+            int e = graph.edge_id(graph.find_edge(x, ps[x]));
+            pathRef[e] += delta;
+            if(delta > 0 && pathRef[e] == 1) {
+                pathPos[e] = pathEdges.size();
+                pathEdges.push_back(e);
+            } else if(delta < 0 && pathRef[e] == 0) {
+                int last = pathEdges.back();
+                pathEdges[pathPos[e]] = last;
+                pathPos[last] = pathPos[e];
+                pathEdges.pop_back();
+                pathPos[e] = -1;
+            }
+        }
+    }
+    
+    // Kruskal over cand (terminal pairs), replacing terminalTree and re-expanding only the
+    // paths of edges that left or entered it
+    void update_terminal_tree(vector<pair<int,int>>& cand) {
+        sort(cand.begin(), cand.end(), [&](const pair<int,int>& a, const pair<int,int>& b) {
+            int ca = metric[a.first][a.second], cb = metric[b.first][b.second];
+            return ca != cb ? ca < cb : a < b;
+        });
+        vector<int> touched;
+        vector<pair<int,int>> tree;
+        for(auto& e : cand) {
+            touched.push_back(e.first);
+            touched.push_back(e.second);
+            if(metric[e.first][e.second] == INT_MAX || !dsu.unite(e.first, e.second)) continue;
+            tree.push_back(e);
+        }
+        dsu.reset(touched);
+        
+        auto key = [](pair<int,int> e) { return e.first < e.second ? e : make_pair(e.second, e.first); };
+        vector<pair<int,int>> before, after;
+        for(auto& e : terminalTree) before.push_back(key(e));
+        for(auto& e : tree) after.push_back(key(e));
+        sort(before.begin(), before.end());
+        sort(after.begin(), after.end());
+        vector<pair<int,int>> gone, added;
+        set_difference(before.begin(), before.end(), after.begin(), after.end(), back_inserter(gone));
+        set_difference(after.begin(), after.end(), before.begin(), before.end(), back_inserter(added));
+        for(auto& e : gone) expand_path(e.first, e.second, -1);
+        for(auto& e : added) expand_path(e.first, e.second, 1);
+        terminalTree = after;
+    }
+    
+    // Final tree from the union of paths: edges in id order (i.e. sorted by endpoints, as in
+    // replace_with_shortest_paths), dropping those that close a cycle
+    void assemble_tree() {
+        vector<int> ids = pathEdges;
+        sort(ids.begin(), ids.end());
+        vector<int> touched;
+        bestSteinerTree.clear();
+        for(int e : ids) {
+            int u = graph.edge_u(e), v = graph.edge_v(e);
+            touched.push_back(u);
+            touched.push_back(v);
+            if(dsu.unite(u, v)) bestSteinerTree.push_back({u, v});
+        }
+        dsu.reset(touched);
+        sort(touched.begin(), touched.end());
+        touched.erase(unique(touched.begin(), touched.end()), touched.end());
+        bestSteinerVertices = touched;
+        
+        minCost = 0;
+        for(auto& e : terminalTree) minCost += metric[e.first][e.second];
+    }
+    
+    // Builds the incremental state for the current terminals from scratch
+    void start_incremental() {
+        graph.finalize();
+        if(metric.size() != n || metricHash != graph.content_hash()) convert_metric();
+        vector<int> R;
+        for(int t : terminals) if(find(R.begin(), R.end(), t) == R.end()) R.push_back(t);
+        terminals = R;
+        
+        prepare_scratch();
+        pathRef.assign(graph.num_edges(), 0);
+        pathPos.assign(graph.num_edges(), -1);
+        pathEdges.clear();
+        bool connected;
+        terminalTree = terminal_mst(R, connected);
+        for(auto& e : terminalTree) {
+            if(e.first > e.second) swap(e.first, e.second);
+            expand_path(e.first, e.second, 1);
+        }
+        incremental = true;
+        assemble_tree();
+    }
+    
+    void add_terminal(int v) {
+        if(v < 0 || v >= n) return;
+        bool isNew = !isTerminal[v];
+        if(isNew) {
+            isTerminal[v] = true;
+            terminals.push_back(v);
+        }
+        if(!incremental) {
+            start_incremental();
+        } else if(isNew) {
+            // the new MST uses only old MST edges and edges at v
+            vector<pair<int,int>> cand = terminalTree;
+            for(int t : terminals) if(t != v) cand.push_back({min(t, v), max(t, v)});
+            update_terminal_tree(cand);
+            assemble_tree();
+        }
+        if(verbose) cout << "Terminal " << v << " added: MST cost " << minCost << ", "
+                         << bestSteinerTree.size() << " tree edges" << endl;
+    }
+    
+    void remove_terminal(int v) {
+        if(v < 0 || v >= n) return;
+        bool wasTerminal = isTerminal[v];
+        if(wasTerminal) {
+            isTerminal[v] = false;
+            terminals.erase(remove(terminals.begin(), terminals.end(), v), terminals.end());
+        }
+        if(!incremental) {
+            start_incremental();
+        } else if(wasTerminal) {
+            // dropping v splits its MST component into one part per MST neighbor; the new MST is
+            // the rest of the old one plus the cheapest edge between each pair of those parts
+            vector<pair<int,int>> cand;
+            vector<int> touched, nbrs;
+            for(auto& e : terminalTree) {
+                if(e.first == v || e.second == v) {
+                    nbrs.push_back(e.first == v ? e.second : e.first);
+                    continue;
+                }
+                touched.push_back(e.first);
+                touched.push_back(e.second);
+                cand.push_back(e);
+                dsu.unite(e.first, e.second);
+            }
+            int d = nbrs.size();
+            if(d > 1) {
+                // terminals of each part; other components of the forest are left alone
+                vector<int> roots(d);
+                vector<vector<int>> part(d);
+                for(int i = 0; i < d; i++) compIndex[roots[i] = dsu.find(nbrs[i])] = i;
+                for(int t : terminals) {
+                    int c = compIndex[dsu.find(t)];
+                    if(c >= 0) part[c].push_back(t);
+                }
+                for(int r : roots) compIndex[r] = -1;
+                dsu.reset(touched);
+                
+                // every pair of parts is scanned from its smaller-indexed side, except that the
+                // largest part is never the scanning side: O(k * terminals outside the largest part)
+                int largest = 0;
+                for(int i = 1; i < d; i++) if(part[i].size() > part[largest].size()) largest = i;
+                vector<pair<int,int>> cheapest((size_t)d * d, make_pair(-1, -1));
+                for(int c = 0; c < d; c++) {
+                    if(c == largest) continue;
+                    for(int c2 = 0; c2 < d; c2++) {
+                        if(c2 == c || (c2 < c && c2 != largest)) continue;
+                        pair<int,int>& best = cheapest[(size_t)c * d + c2];
+                        for(int x : part[c]) {
+                            const int* row = metric[x];
+                            for(int y : part[c2]) {
+                                if(row[y] == INT_MAX) continue;
+                                if(best.first < 0 || row[y] < metric[best.first][best.second]) best = make_pair(x, y);
+                            }
+                        }
+                        if(best.first >= 0) cand.push_back(make_pair(min(best.first, best.second), max(best.first, best.second)));
+                    }
+                }
+            } else {
+                dsu.reset(touched);
+            }
+            update_terminal_tree(cand);
+            assemble_tree();
+        }
+        if(verbose) cout << "Terminal " << v << " removed: MST cost " << minCost << ", "
+                         << bestSteinerTree.size() << " tree edges" << endl;
+    }
+    
     int getMinCost() { return minCost; }
     double getExecutionTime() { return executionTime; }
     vector<pair<int,int>> getBestSteinerTree() { return bestSteinerTree; }